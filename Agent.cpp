@@ -15,17 +15,71 @@
 
 #include "Agent.h"
 #include "BeatTracker.h"
+#include "TrackerContext.h"
+
+#include <new>
 
 const double AgentParameters::DEFAULT_POST_MARGIN_FACTOR = 0.3;
 const double AgentParameters::DEFAULT_PRE_MARGIN_FACTOR = 0.15;
 const double AgentParameters::DEFAULT_MAX_CHANGE = 0.2;
 const double AgentParameters::DEFAULT_EXPIRY_TIME = 10.0;
+const int AgentParameters::DEFAULT_THREAD_COUNT = 1;
+const double AgentParameters::DEFAULT_DECAY_FACTOR = 0.0;
+const double AgentParameters::DEFAULT_CAUSAL_DECAY_FACTOR = 400.0;
+const int AgentParameters::DEFAULT_MAX_AGENTS = 0;
+const bool AgentParameters::DEFAULT_PRUNE_DOMINATED = false;
 
 const double Agent::INNER_MARGIN = 0.040;
 const double Agent::CONF_FACTOR = 0.5;
 const double Agent::DEFAULT_CORRECTION_FACTOR = 50.0;
 
-int Agent::idCounter = 0;
+AgentArena::AgentArena() :
+    agents(sizeof(Agent), 256),
+    nodes(EventHistory::getNodeSize(), 4096)
+{
+}
+
+Agent::Agent(TrackerContext &c, double ibi) :
+    context(&c),
+    innerMargin(INNER_MARGIN),
+    correctionFactor(DEFAULT_CORRECTION_FACTOR),
+    expiryTime(c.agentParameters.expiryTime),
+    decayFactor(c.getDecayFactor()),
+    preMargin(ibi * c.agentParameters.preMarginFactor),
+    postMargin(ibi * c.agentParameters.postMarginFactor),
+    idNumber(c.newAgentId()),
+    tempoScore(0.0),
+    phaseScore(0.0),
+    topScoreTime(0.0),
+    beatCount(0),
+    beatInterval(ibi),
+    initialBeatInterval(ibi),
+    beatTime(-1.0),
+    maxChange(c.agentParameters.maxChange),
+    events(&c.arena.nodes),
+    scheduleIndex(-1)
+{
+} // constructor
+
+Agent *Agent::create(TrackerContext &context, double ibi)
+{
+    return new (context.arena.agents.allocate()) Agent(context, ibi);
+} // create()
+
+void Agent::destroy(Agent *a)
+{
+    AgentArena &arena = a->context->arena;
+    a->~Agent();
+    arena.agents.deallocate(a);
+} // destroy()
+
+Agent *Agent::clone() const
+{
+    Agent *a = new (context->arena.agents.allocate()) Agent(*this);
+    a->idNumber = context->newAgentId();
+    a->scheduleIndex = -1;
+    return a;
+} // clone()
 
 void Agent::accept(Event e, double err, int beats) {
     beatTime = e.time;
@@ -37,9 +91,12 @@ void Agent::accept(Event e, double err, int beats) {
     double conFactor = 1.0 - CONF_FACTOR * err /
         (err>0? postMargin: -preMargin);
     if (decayFactor > 0) {
-        double memFactor = 1. - 1. / threshold((double)beatCount,1,decayFactor);
-        phaseScore = memFactor * phaseScore +
-            (1.0 - memFactor) * conFactor * e.salience;
+        // Decay the score for each beat period since the last beat,
+        // whether or not it was matched, so that the score is a sum
+        // over roughly the last decayFactor beats
+        double memFactor = 1. - 1. / threshold(decayFactor, 1, HUGE_VAL);
+        phaseScore = pow(memFactor, beats) * phaseScore +
+            conFactor * e.salience;
     } else
         phaseScore += conFactor * e.salience;
 
@@ -51,24 +108,26 @@ void Agent::accept(Event e, double err, int beats) {
 #endif
 } // accept()
 
-bool Agent::considerAsBeat(Event e, AgentList &a) {
+Agent::Judgement Agent::judge(const Event &e) const {
+    Judgement j;
+    j.action = Judgement::Ignore;
+    j.err = 0;
+    j.beats = 1;
     if (beatTime < 0) {	// first event
 #ifdef DEBUG_BEATROOT
         std::cerr << "Ag#" << idNumber << ": accepting first event trivially at " << e.time << std::endl;
 #endif
-	accept(e, 0, 1);
-	return true;
+        j.action = Judgement::Accept;
     } else {			// subsequent events
-        EventList::iterator last = events.end();
-        --last;
-	if (e.time - last->time > expiryTime) {
+        const Event &last = events.back();
+	if (e.time - last.time > expiryTime) {
 #ifdef DEBUG_BEATROOT
             std::cerr << "Ag#" << idNumber << ": time " << e.time 
-                      << " too late relative to " << last->time << " (expiry "
+                      << " too late relative to " << last.time << " (expiry "
                       << expiryTime << "), giving up" << std::endl;
 #endif
-	    phaseScore = -1.0;	// flag agent to be deleted
-	    return false;
+            j.action = Judgement::Expire;
+	    return j;
 	}
 	double beats = nearbyint((e.time - beatTime) / beatInterval);
 	double err = e.time - beatTime - beats * beatInterval;
@@ -76,35 +135,75 @@ bool Agent::considerAsBeat(Event e, AgentList &a) {
         std::cerr << "Ag#" << idNumber << ": time " << e.time << ", err " << err << " for beats " << beats << std::endl;
 #endif
 	if ((beats > 0) && (-preMargin <= err) && (err <= postMargin)) {
-	    if (fabs(err) > innerMargin) {
+            j.action = (fabs(err) > innerMargin)?
+                Judgement::Fork: Judgement::Accept;
+            j.err = err;
+            j.beats = (int)beats;
+	}
+    }
+    return j;
+} // judge()
+
+bool Agent::apply(const Event &e, const Judgement &j, AgentList &a) {
+    BEATROOT_STATS(++context->stats.considered);
+    switch (j.action) {
+    case Judgement::Expire:
+        BEATROOT_STATS(++context->stats.expired);
+	phaseScore = -1.0;	// flag agent to be deleted
+	return false;
+    case Judgement::Fork:
 #ifdef DEBUG_BEATROOT
-                std::cerr << "Ag#" << idNumber << ": creating another new agent" << std::endl;
+        std::cerr << "Ag#" << idNumber << ": creating another new agent" << std::endl;
 #endif
-                // Create new agent that skips this event (avoids
-                // large phase jump)
-		a.add(clone());
-            }
-	    accept(e, err, (int)beats);
-	    return true;
-	}
+        // Create new agent that skips this event (avoids large phase
+        // jump).  The list is re-sorted by AgentList::beatTrack once
+        // all agents have seen the event.
+        a.add(clone(), false);
+        BEATROOT_STATS(++context->stats.forks);
+        // fall through
+    case Judgement::Accept:
+        accept(e, j.err, j.beats);
+        return true;
+    default:
+        return false;
     }
-    return false;
-} // considerAsBeat()
+} // apply()
 
+double Agent::nextWindowTime(double time) const {
+    if (beatTime < 0)  // accepts any event as its first beat
+        return time;
+    // Allow for rounding in the comparisons made by considerAsBeat()
+    const double slack = 1e-6;
+    double expiry = beatTime + expiryTime - slack;
+    // The first window (at least one beat ahead) which does not end
+    // before time
+    double beats = ceil((time - beatTime - postMargin - slack) / beatInterval);
+    if (!(beats > 1)) beats = 1;
+    double window = beatTime + beats * beatInterval - preMargin - slack;
+    return (window < expiry)? window: expiry;
+} // nextWindowTime()
 
-void Agent::fillBeats(double start) {
-    EventList::iterator it = events.begin();
-    if (it == events.end())
+void Agent::fillBeats(EventList &el, double start) const {
+    if (el.empty())
         return;
+    BEATROOT_STATS(TrackingStats::Timer timer(context->stats.fillTime));
+    // The interpolated beats are merged with the given ones into a
+    // new list, rather than inserted in place
+    EventList filled;
+    filled.reserve(el.size());
+    EventList::const_iterator it = el.begin();
     double prevBeat = it->time;
-    for (++it; it != events.end(); ++it) {
+    filled.push_back(*it);
+    for (++it; it != el.end(); ++it) {
         double nextBeat = it->time;
         double beats = nearbyint((nextBeat - prevBeat) / beatInterval - 0.01);   // prefer slow
         double currentInterval = (nextBeat - prevBeat) / beats;
         for ( ; (nextBeat > start) && (beats > 1.5); --beats) {
 	        prevBeat += currentInterval;
-            events.insert(it, BeatTracker::newBeat(prevBeat, 0));
+            filled.push_back(BeatTracker::newBeat(prevBeat, 0));
 	    }
+        filled.push_back(*it);
 	    prevBeat = nextBeat;
     }
+    el.swap(filled);
 } // fillBeats()
@@ -17,6 +17,8 @@
 #define _AGENT_H_
 
 #include "Event.h"
+#include "EventHistory.h"
+#include "MemoryPool.h"
 
 #include <cmath>
 
@@ -25,6 +27,7 @@
 #endif
 
 class AgentList;
+class TrackerContext;
 
 class AgentParameters
 {
@@ -33,12 +36,21 @@ public:
     static const double DEFAULT_PRE_MARGIN_FACTOR;
     static const double DEFAULT_MAX_CHANGE;
     static const double DEFAULT_EXPIRY_TIME;
+    static const int DEFAULT_THREAD_COUNT;
+    static const double DEFAULT_DECAY_FACTOR;
+    static const double DEFAULT_CAUSAL_DECAY_FACTOR;
+    static const int DEFAULT_MAX_AGENTS;
+    static const bool DEFAULT_PRUNE_DOMINATED;
 
     AgentParameters() :
         postMarginFactor(DEFAULT_POST_MARGIN_FACTOR),
         preMarginFactor(DEFAULT_PRE_MARGIN_FACTOR),
         maxChange(DEFAULT_MAX_CHANGE),
-        expiryTime(DEFAULT_EXPIRY_TIME) { }
+        expiryTime(DEFAULT_EXPIRY_TIME),
+        threadCount(DEFAULT_THREAD_COUNT),
+        decayFactor(DEFAULT_DECAY_FACTOR),
+        maxAgents(DEFAULT_MAX_AGENTS),
+        pruneDominated(DEFAULT_PRUNE_DOMINATED) { }
 
     /** The maximum amount by which a beat can be later than the
      *  predicted beat time, expressed as a fraction of the beat
@@ -58,6 +70,68 @@ public:
      *  seconds) after which an Agent that has no Event matching its
      *  beat predictions will be destroyed. */
     double expiryTime;
+
+    /** The number of threads over which the Agents are divided when
+     *  testing each onset against their predictions.  The beats found
+     *  are identical whatever the number of threads. */
+    int threadCount;
+
+    /** If greater than zero, the number of recent beats over which
+     *  an Agent's score is averaged, with exponentially decaying
+     *  weights, rather than summed over the whole piece.  This lets
+     *  a causal (real-time) tracker follow changes in the music.
+     *  Zero (the default) gives cumulative scores in batch tracking,
+     *  and DEFAULT_CAUSAL_DECAY_FACTOR in causal tracking (see
+     *  TrackerContext::getDecayFactor()). */
+    double decayFactor;
+
+    /** If greater than zero, the largest number of Agents kept after
+     *  each Event (the beam width).  Beyond it, the Agents with the
+     *  lowest phaseScore within each tempo group are removed, so
+     *  that every tempo group keeps its best Agent if possible.  This
+     *  bounds the work done for each Event on noisy or syncopated
+     *  input, where forking can otherwise multiply the Agents, but
+     *  may lose the Agent that would have done best.  Zero for no
+     *  limit. */
+    int maxAgents;
+
+    /** Whether AgentList::beatTrack() removes the Agents that cannot
+     *  catch up with the best one: those whose phaseScore, even if
+     *  they accepted every remaining Event at full salience, would
+     *  still be lower than the best Agent's is already.  Only Agents
+     *  which cannot expire before the next such check, every few
+     *  Events, count as the best.  This is lossless as long as the
+     *  best Agent survives to the end, so it does not change the
+     *  beats found unless that Agent expires later still, after a
+     *  gap of more than expiryTime seconds without a beat.  It has
+     *  no effect with decaying or average scores, whose best Agent
+     *  may lose its lead without expiring, nor in segmented or causal
+     *  tracking, which do not know the Events to come. */
+    bool pruneDominated;
+};
+
+/** The memory from which the Agents of a single beat tracking run,
+ *  and their beat histories, are allocated (see Agent::create()).
+ *  Agents deleted during tracking are recycled within the arena, and
+ *  the whole population is released at once when the arena is reset
+ *  or destroyed, without deleting each Agent individually.
+ */
+class AgentArena
+{
+public:
+    AgentArena();
+
+    /** Storage for Agent objects */
+    MemoryPool agents;
+
+    /** Storage for the nodes of the Agents' EventHistory objects */
+    MemoryPool nodes;
+
+    /** Releases all Agents and histories allocated from the arena. */
+    void reset() {
+        agents.reset();
+        nodes.reset();
+    }
 };
 
 /** Agent is the central class for beat tracking.
@@ -86,8 +160,9 @@ public:
     static const double DEFAULT_CORRECTION_FACTOR;
 	
 protected:
-    /** The identity number of the next created Agent */
-    static int idCounter;
+    /** The tracker to which this Agent belongs, which numbers it and
+     *  in whose arena it is allocated. */
+    TrackerContext *context;
 	
     /** The maximum time (in seconds) that a beat can deviate from the
      *  predicted beat time without a fork occurring (i.e. a 2nd Agent
@@ -105,8 +180,9 @@ protected:
      *  matching its beat predictions will be destroyed. */
     double expiryTime;
 	
-    /** For scoring Agents in a (non-existent) real-time version
-     * (otherwise not used). */
+    /** For scoring Agents in causal (real-time) tracking: the
+     *  number of recent beats over which the score is averaged, or
+     *  zero for a cumulative score (see AgentParameters). */
     double decayFactor;
 
 public:
@@ -150,38 +226,37 @@ public:
      * expressed as a fraction of the initial beat period. */
     double maxChange;
 	
-    /** The list of Events (onsets) accepted by this Agent as beats,
-     * plus interpolated beats. */
-    EventList events;
+    /** The Events (onsets) accepted by this Agent as beats.  The
+     *  history is shared with the Agents cloned from this one; use
+     *  getEvents() to obtain it as a list. */
+    EventHistory events;
 
-    /** Constructor: the work is performed by init()
-     *  @param ibi The beat period (inter-beat interval) of the Agent's tempo hypothesis.
+    /** The position of this Agent in the AgentScheduler queue of its
+     *  AgentList, or -1 if it is not currently scheduled. */
+    int scheduleIndex;
+
+    /** Creates a new Agent belonging to the given tracker, allocated
+     *  in its arena.  The Agent must be released with destroy().
+     *  @param context The tracker, which supplies the parameters and
+     *     the identity number of the Agent
+     *  @param ibi The beat period of the Agent's tempo hypothesis
      */
-    Agent(AgentParameters params, double ibi) :
-	innerMargin(INNER_MARGIN),
-	correctionFactor(DEFAULT_CORRECTION_FACTOR),
-	expiryTime(params.expiryTime),
-	decayFactor(0),
-	preMargin(ibi * params.preMarginFactor),
-	postMargin(ibi * params.postMarginFactor),
-	idNumber(idCounter++),
-	tempoScore(0.0),
-	phaseScore(0.0),
-	topScoreTime(0.0),
-	beatCount(0),
-	beatInterval(ibi),
-	initialBeatInterval(ibi),
-	beatTime(-1.0),
-        maxChange(params.maxChange) {
-    } // constructor
-
-    Agent *clone() const {
-        Agent *a = new Agent(*this);
-        a->idNumber = idCounter++;
-        return a;
-    }
+    static Agent *create(TrackerContext &context, double ibi);
+
+    /** Releases an Agent obtained from create() or clone(). */
+    static void destroy(Agent *a);
+
+    /** Creates a copy of this Agent with a new identity number, in
+     *  the same tracker as this one. */
+    Agent *clone() const;
 
 protected:
+    /** Constructor: use create() to obtain a new Agent
+     *  @param context The tracker to which the Agent belongs
+     *  @param ibi The beat period (inter-beat interval) of the Agent's tempo hypothesis.
+     */
+    Agent(TrackerContext &context, double ibi);
+
     double threshold(double value, double min, double max) {
 	if (value < min)
 	    return min;
@@ -209,17 +284,78 @@ public:
      * @param a The list of all agents, which is updated if a new agent is created.
      * @return Indicate whether the given Event was accepted as a beat by this Agent.
      */
-    bool considerAsBeat(Event e, AgentList &a);
+    bool considerAsBeat(Event e, AgentList &a) {
+        return apply(e, judge(e), a);
+    } // considerAsBeat()
+
+    /** The outcome of testing an Event against the Agent's beat
+     *  predictions, as made by judge() and carried out by apply().
+     */
+    struct Judgement {
+        enum Action {
+            Ignore,     ///< outside the windows around the predictions
+            Expire,     ///< too long since the last beat; terminate
+            Accept,     ///< accept as a beat
+            Fork        ///< accept, and create a new Agent that doesn't
+        };
+        Action action;
+        /** The difference between the predicted and actual beat times */
+        double err;
+        /** The number of beats since the last beat */
+        int beats;
+    };
+
+    /** Tests the given Event as a possible beat time, without changing
+     *  the state of this or any other Agent.  This is the first half of
+     *  considerAsBeat(), and may be called concurrently for different
+     *  Agents.
+     */
+    Judgement judge(const Event &e) const;
 
-    /** Interpolates missing beats in the Agent's beat track, starting from the beginning of the piece. */
-    void fillBeats() {
-	fillBeats(-1.0);
-    } // fillBeats()/0
+    /** Updates the Agent (and the list of all agents, if a new agent
+     *  is created) according to the result of judge() for the Event.
+     *  This is the second half of considerAsBeat().
+     *  @return Indicate whether the given Event was accepted as a beat by this Agent.
+     */
+    bool apply(const Event &e, const Judgement &j, AgentList &a);
+
+    /** Returns a lower bound on the time of the next Event which
+     *  could change the state of this Agent in considerAsBeat(),
+     *  i.e. an Event which falls within one of the windows around the
+     *  Agent's predicted beat times, or which arrives after the
+     *  Agent's expiry time.  Events earlier than this are always
+     *  ignored by the Agent.
+     *  @param time The time of the most recent Event offered to the
+     *     Agent; later Events are assumed not to be earlier than this
+     */
+    double nextWindowTime(double time) const;
+
+    /** @return Whether the Agent would expire on being offered an
+     *  Event at the given time, if it accepted no Event before then
+     *  (see judge()).  An Agent with no beats yet does not expire. */
+    bool wouldExpireBy(double time) const {
+        return !events.empty() && time - events.back().time > expiryTime;
+    }
+
+    /** @return The list of Events accepted by this Agent as beats, in time order. */
+    EventList getEvents() const {
+        return events.toList();
+    } // getEvents()
+
+    /** Interpolates missing beats in a beat track obtained from this
+     *  Agent by getEvents(), starting from the beginning of the piece.
+     *  @param el The beat track, to which interpolated beats are added
+     */
+    void fillBeats(EventList &el) const {
+	fillBeats(el, -1.0);
+    } // fillBeats()/1
 
-    /** Interpolates missing beats in the Agent's beat track.
+    /** Interpolates missing beats in a beat track obtained from this
+     *  Agent by getEvents().
+     *  @param el The beat track, to which interpolated beats are added
      *  @param start Ignore beats earlier than this start time 
      */
-    void fillBeats(double start);
+    void fillBeats(EventList &el, double start) const;
 
 }; // class Agent
 
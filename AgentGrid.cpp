@@ -0,0 +1,62 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+#include "AgentGrid.h"
+
+#include <algorithm>
+
+// Relative amount by which the cells exceed the search distances
+static const double CELL_PADDING = 1e-3;
+
+void AgentGrid::build(const std::vector<Agent *> &agents,
+                      double maxBI, double maxBT)
+{
+    cellBI = maxBI * (1.0 + CELL_PADDING);
+    cellBT = maxBT * (1.0 + CELL_PADDING);
+    int n = agents.size();
+    size_t tableSize = 16;
+    while (tableSize < 2 * (size_t)n) tableSize *= 2;
+    mask = tableSize - 1;
+    heads.assign(tableSize, -1);
+    next.resize(n);
+    cellX.resize(n);
+    cellY.resize(n);
+    // Insert in reverse so that each chain runs in ascending index order
+    for (int i = n - 1; i >= 0; --i) {
+        cellX[i] = (long long)floor(agents[i]->beatInterval / cellBI);
+        cellY[i] = (long long)floor(agents[i]->beatTime / cellBT);
+        unsigned long long h = hash(cellX[i], cellY[i]);
+        next[i] = heads[h];
+        heads[h] = i;
+    }
+} // build()
+
+void AgentGrid::findNeighbours(int index, std::vector<int> &neighbours) const
+{
+    size_t first = neighbours.size();
+    long long x = cellX[index], y = cellY[index];
+    for (long long dx = 0; dx <= 1; ++dx) {
+        for (long long dy = -1; dy <= 1; ++dy) {
+            for (int i = heads[hash(x + dx, y + dy)]; i >= 0; i = next[i]) {
+                if (i > index && cellX[i] == x + dx && cellY[i] == y + dy) {
+                    neighbours.push_back(i);
+                }
+            }
+        }
+    }
+    if (neighbours.size() > first + 1) {
+        std::sort(neighbours.begin() + first, neighbours.end());
+    }
+} // findNeighbours()
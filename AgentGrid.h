@@ -0,0 +1,78 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+#ifndef _AGENT_GRID_H_
+#define _AGENT_GRID_H_
+
+#include "Agent.h"
+
+#include <vector>
+
+/** Spatial hash of a list of Agents over the (beatInterval, beatTime)
+ *  plane, used by AgentList::removeDuplicates() to find the Agents
+ *  that lie within a given tempo and phase distance of each other
+ *  without comparing every pair.
+ *
+ *  Each Agent is placed in the grid cell containing its beat interval
+ *  and beat time.  The cells are slightly larger than the distances
+ *  being searched for, so that any two Agents closer than those
+ *  distances are always in the same or adjacent cells, whatever the
+ *  rounding of the cell calculation.
+ */
+class AgentGrid
+{
+public:
+    /** Constructs an empty grid; build() must be called before
+     *  findNeighbours(). */
+    AgentGrid() : cellBI(0), cellBT(0), mask(0) { }
+
+    /** Places the given Agents in the grid, replacing any previous
+     *  contents.  Agents are identified by their index in the vector.
+     *  @param agents The Agents to index
+     *  @param maxBI The greatest beat interval difference searched for
+     *  @param maxBT The greatest beat time difference searched for
+     */
+    void build(const std::vector<Agent *> &agents, double maxBI, double maxBT);
+
+    /** Appends to neighbours the indices of all Agents after the
+     *  given one which may be within maxBI of its beat interval
+     *  (above it) and maxBT of its beat time (either side).  The
+     *  indices are returned in ascending order.
+     *  @param index The index of an Agent passed to build()
+     */
+    void findNeighbours(int index, std::vector<int> &neighbours) const;
+
+protected:
+    double cellBI;
+    double cellBT;
+
+    /** Cell coordinates of each Agent */
+    std::vector<long long> cellX;
+    std::vector<long long> cellY;
+
+    /** Hash table of chains of Agents, linked through next */
+    std::vector<int> heads;
+    std::vector<int> next;
+    unsigned long long mask;
+
+    unsigned long long hash(long long x, long long y) const {
+        unsigned long long h = (unsigned long long)x * 0x9E3779B97F4A7C15ULL;
+        h ^= (unsigned long long)y * 0xC2B2AE3D27D4EB4FULL;
+        return (h ^ (h >> 29)) & mask;
+    }
+
+}; // class AgentGrid
+
+#endif
@@ -14,54 +14,100 @@
 */
 
 #include "AgentList.h"
+#include "TrackerContext.h"
 
-bool AgentList::useAverageSalience = false;
 const double AgentList::DEFAULT_BI = 0.02;
 const double AgentList::DEFAULT_BT = 0.04;
+const int AgentList::MIN_PARALLEL_AGENTS = 512;
+const double AgentList::DEFAULT_NEW_AGENT_TIME = 5.0;
+const int AgentList::DOMINANCE_PERIOD = 8;
+
+/** Judges an Event for a set of agents, one shard of them per task */
+class JudgeTask : public ThreadPool::Task
+{
+public:
+    JudgeTask(const Event &e, const AgentList::Container &a,
+              std::vector<Agent::Judgement> &j, int s) :
+        event(e), agents(a), judgements(j), shardSize(s) { }
+
+    void run(int shard) {
+        int end = (shard + 1) * shardSize;
+        if (end > (int)agents.size()) end = agents.size();
+        for (int i = shard * shardSize; i < end; ++i) {
+            judgements[i] = agents[i]->judge(event);
+        }
+    }
+
+protected:
+    const Event &event;
+    const AgentList::Container &agents;
+    std::vector<Agent::Judgement> &judgements;
+    int shardSize;
+};
+
+void AgentList::judgeAll(const Event &e, const Container &agents,
+                         std::vector<Agent::Judgement> &judgements,
+                         ThreadPool *pool)
+{
+    int n = agents.size();
+    judgements.resize(n);
+    if (!pool || n < MIN_PARALLEL_AGENTS) {
+        for (int i = 0; i < n; ++i) {
+            judgements[i] = agents[i]->judge(e);
+        }
+        return;
+    }
+    // A few shards per thread, so that there is something to steal
+    int shards = pool->getThreadCount() * 4;
+    int shardSize = (n + shards - 1) / shards;
+    JudgeTask task(e, agents, judgements, shardSize);
+    pool->run(task, (n + shardSize - 1) / shardSize);
+} // judgeAll()
 
 void AgentList::removeDuplicates() 
 {
-    sort();
-    for (iterator itr = begin(); itr != end(); ++itr) {
+    // Only agents in neighbouring cells of the grid can be close
+    // enough to be duplicates.  Each agent's neighbours are visited
+    // in list order, as in a scan along the (sorted) list.
+    grid.build(list, DEFAULT_BI, DEFAULT_BT);
+    std::vector<int> neighbours;
+    for (int i = 0; i < (int)list.size(); ++i) {
+        Agent *agent = list[i];
 #ifdef DEBUG_BEATROOT
-        std::cerr << "removeDuplicates: considering agent " << (*itr)->idNumber << std::endl;
+        std::cerr << "removeDuplicates: considering agent " << agent->idNumber << std::endl;
 #endif
-        if ((*itr)->phaseScore < 0.0) // already flagged for deletion
+        if (agent->phaseScore < 0.0) // already flagged for deletion
             continue;
-        iterator itr2 = itr;
-        for (++itr2; itr2 != end(); ++itr2) {
-            if ((*itr2)->beatInterval - (*itr)->beatInterval > DEFAULT_BI)
+        neighbours.clear();
+        grid.findNeighbours(i, neighbours);
+        for (std::vector<int>::iterator ni = neighbours.begin();
+             ni != neighbours.end(); ++ni) {
+            Agent *other = list[*ni];
+            if (other->beatInterval - agent->beatInterval > DEFAULT_BI)
                 break;
-            if (fabs((*itr)->beatTime - (*itr2)->beatTime) > DEFAULT_BT)
+            if (fabs(agent->beatTime - other->beatTime) > DEFAULT_BT)
                 continue;
-            if ((*itr)->phaseScore < (*itr2)->phaseScore) {
+            if (agent->phaseScore < other->phaseScore) {
 #ifdef DEBUG_BEATROOT
-                std::cerr << "agent " << (*itr)->idNumber << " is similar to but lower-scoring than agent " << (*itr2)->idNumber << ", marking for deletion" << std::endl;
+                std::cerr << "agent " << agent->idNumber << " is similar to but lower-scoring than agent " << other->idNumber << ", marking for deletion" << std::endl;
 #endif
-                (*itr)->phaseScore = -1.0;	// flag for deletion
-                if ((*itr2)->topScoreTime < (*itr)->topScoreTime)
-                    (*itr2)->topScoreTime = (*itr)->topScoreTime;
+                agent->phaseScore = -1.0;	// flag for deletion
+                if (other->topScoreTime < agent->topScoreTime)
+                    other->topScoreTime = agent->topScoreTime;
                 break;
             } else {
 #ifdef DEBUG_BEATROOT
-                std::cerr << "agent " << (*itr2)->idNumber << " is similar to but lower-scoring than agent " << (*itr)->idNumber << ", marking for deletion" << std::endl;
+                std::cerr << "agent " << other->idNumber << " is similar to but lower-scoring than agent " << agent->idNumber << ", marking for deletion" << std::endl;
 #endif
-                (*itr2)->phaseScore = -1.0;	// flag for deletion
-                if ((*itr)->topScoreTime < (*itr2)->topScoreTime)
-                    (*itr)->topScoreTime = (*itr2)->topScoreTime;
+                other->phaseScore = -1.0;	// flag for deletion
+                if (agent->topScoreTime < other->topScoreTime)
+                    agent->topScoreTime = other->topScoreTime;
             }
         }
     }
-    int removed = 0;
-    for (iterator itr = begin(); itr != end(); ) {
-        if ((*itr)->phaseScore < 0.0) {
-            ++removed;
-            delete *itr;
-            list.erase(itr);
-        } else {
-            ++itr;
-        }
-    }
+    int removed = removeFlagged();
+    (void)removed; // only for statistics and debugging
+    BEATROOT_STATS(context->stats.duplicates += removed);
 #ifdef DEBUG_BEATROOT
     if (removed > 0) {
         std::cerr << "removeDuplicates: removed " << removed << ", have "
@@ -74,49 +120,289 @@ void AgentList::removeDuplicates()
 #endif
 } // removeDuplicates()
 
+int AgentList::removeFlagged()
+{
+    // Compact the surviving agents in a single pass
+    int removed = 0;
+    Container::iterator out = list.begin();
+    for (iterator itr = begin(); itr != end(); ++itr) {
+        if ((*itr)->phaseScore < 0.0) {
+            ++removed;
+            scheduler.unschedule(*itr);
+            Agent::destroy(*itr);
+        } else {
+            *out++ = *itr;
+        }
+    }
+    list.erase(out, list.end());
+    return removed;
+} // removeFlagged()
+
+/** Orders the Agents of a tempo group by decreasing phaseScore,
+ *  which is their rank within the group */
+class ScoreOrder
+{
+public:
+    bool operator()(const Agent *x, const Agent *y) const {
+        if (x->phaseScore != y->phaseScore)
+            return x->phaseScore > y->phaseScore;
+        return x->idNumber < y->idNumber;
+    }
+};
+
+void AgentList::prune(int maxAgents)
+{
+    // Share the Agents out between their tempo groups
+    size_t groupCount = 0, largest = 0;
+    groupIndex.clear();
+    for (iterator itr = begin(); itr != end(); ++itr) {
+        std::pair<std::map<double, size_t>::iterator, bool> found =
+            groupIndex.insert(std::make_pair((*itr)->initialBeatInterval,
+                                             groupCount));
+        if (found.second) {
+            if (groupCount == groups.size()) groups.push_back(Container());
+            groups[groupCount++].clear();
+        }
+        Container &group = groups[found.first->second];
+        group.push_back(*itr);
+        if (group.size() > largest) largest = group.size();
+    }
+    // The cutoff is the highest rank for which all the Agents ranked
+    // above it in every group fit within the cap, found from the
+    // sizes of the groups alone
+    size_t cutoff = 0, beyond = largest, above = 0;
+    while (beyond - cutoff > 1) {
+        size_t rank = (cutoff + beyond) / 2, count = 0;
+        for (size_t g = 0; g < groupCount; ++g)
+            count += std::min(groups[g].size(), rank);
+        if (count <= size_t(maxAgents)) cutoff = rank;
+        else beyond = rank;
+    }
+    for (size_t g = 0; g < groupCount; ++g)
+        above += std::min(groups[g].size(), cutoff);
+    // Agents ranked below the cutoff are removed, and of those at it,
+    // only the best that fit within the cap are kept
+    candidates.clear();
+    for (size_t g = 0; g < groupCount; ++g) {
+        Container &group = groups[g];
+        if (group.size() <= cutoff) continue;
+        std::nth_element(group.begin(), group.begin() + cutoff,
+                         group.end(), ScoreOrder());
+        candidates.push_back(group[cutoff]);
+        for (size_t i = cutoff + 1; i < group.size(); ++i) {
+            group[i]->phaseScore = -1.0;    // flag for deletion
+        }
+    }
+    size_t keep = maxAgents - above;
+    std::nth_element(candidates.begin(), candidates.begin() + keep,
+                     candidates.end(), ScoreOrder());
+    for (size_t i = keep; i < candidates.size(); ++i) {
+        candidates[i]->phaseScore = -1.0;    // flag for deletion
+    }
+    int removed = removeFlagged();
+    (void)removed; // only for statistics and debugging
+    BEATROOT_STATS(context->stats.pruned += removed);
+#ifdef DEBUG_BEATROOT
+    std::cerr << "prune: removed " << removed << ", have " << list.size()
+              << " agent(s) remaining" << std::endl;
+#endif
+} // prune()
+
+void AgentList::removeDominated(double remaining, double horizon)
+{
+    // Scores as in bestAgent(), which is not used with average
+    // salience.  An Agent which would expire before the horizon if it
+    // found no more beats may not survive to keep its lead.
+    double best = -1.0;
+    for (iterator itr = begin(); itr != end(); ++itr) {
+        if ((*itr)->events.empty()) continue;
+        if ((*itr)->wouldExpireBy(horizon)) continue;
+        double score = (*itr)->phaseScore + (*itr)->tempoScore;
+        if (score > best) best = score;
+    }
+    if (best <= 0.0)
+        return;
+    // Allow for rounding in the sums of salience, so that an Agent
+    // which could tie with the best is never removed
+    double limit = best - 1e-9 * (best + remaining);
+    for (iterator itr = begin(); itr != end(); ++itr) {
+        if ((*itr)->phaseScore + (*itr)->tempoScore + remaining < limit)
+            (*itr)->phaseScore = -1.0;  // flag for deletion
+    }
+    int removed = removeFlagged();
+    (void)removed; // only for statistics and debugging
+    BEATROOT_STATS(context->stats.dominated += removed);
+#ifdef DEBUG_BEATROOT
+    std::cerr << "removeDominated: removed " << removed << ", have "
+              << list.size() << " agent(s) remaining" << std::endl;
+#endif
+} // removeDominated()
 
-void AgentList::beatTrack(EventList el, AgentParameters params, double stop)
+
+void AgentList::beatTrack(const EventList &el, double stop)
 {
-    EventList::iterator ei = el.begin();
-    bool phaseGiven = !empty() && ((*begin())->beatTime >= 0); // if given for one, assume given for others
-    while (ei != el.end()) {
-        Event ev = *ei;
-        ++ei;
-        if ((stop > 0) && (ev.time > stop))
+    size_t count = el.size();
+    if (stop > 0) {
+        count = 0;
+        while (count < el.size() && el[count].time <= stop) ++count;
+    }
+    // The salience still to come after each event, which bounds what
+    // any agent can add to its score.  Decaying scores may fall, and
+    // average scores are not bounded in this way.
+    const AgentParameters &params = context->agentParameters;
+    bool dominance = params.pruneDominated &&
+        !(context->getDecayFactor() > 0) && !context->useAverageSalience;
+    if (dominance) {
+        remaining.resize(count);
+        double sum = 0.0;
+        for (size_t i = count; i > 0; --i) {
+            remaining[i-1] = sum;
+            if (el[i-1].salience > 0.0) sum += el[i-1].salience;
+        }
+    }
+    bool timed = context->deadline.isSet();
+    startTracking();
+    for (size_t i = 0; i < count; ++i) {
+        if (timed && context->deadline.hasPassed()) {
+            // Stop with the beats found so far
+            context->partial = true;
             break;
+        }
+        trackEvent(el[i]);
+        if (dominance && ((i + 1) % DOMINANCE_PERIOD == 0)) {
+            size_t next = std::min(i + DOMINANCE_PERIOD, count - 1);
+            removeDominated(remaining[i], el[next].time);
+        }
+    } // loop for each event
+    finishTracking();
+} // beatTrack()
+
+void AgentList::startTracking(double nat)
+{
+    newAgentTime = nat;
+    phaseGiven = !empty() && ((*begin())->beatTime >= 0); // if given for one, assume given for others
+    // The list is kept in agentComparator order throughout
+    sort();
+    // Each agent is offered only those events that fall at or after
+    // the time returned by its nextWindowTime(); earlier events are
+    // ignored by considerAsBeat in any case
+    scheduler.clear();
+    for (iterator ai = begin(); ai != end(); ++ai) {
+        scheduler.schedule(*ai, (*ai)->nextWindowTime(-HUGE_VAL));
+    }
+    // Only the judging of events can be done in parallel.  The
+    // agents are then updated, and any new agents created, in list
+    // order on this thread, so the results do not depend on the
+    // number of threads.
+    int threads = context->agentParameters.threadCount;
+    pool.reset();
+    if (threads > 1) pool.reset(new ThreadPool(threads));
+} // startTracking()
+
+void AgentList::trackEvent(const Event &ev)
+{
+    BEATROOT_STATS(TrackingStats &stats = context->stats);
+    BEATROOT_STATS(TrackingStats::Timer timer(stats.trackingTime));
+    BEATROOT_STATS(++stats.onsets);
+    BEATROOT_STATS(stats.agentSum += list.size());
+    BEATROOT_STATS(if ((long)list.size() > stats.peakAgents)
+                       stats.peakAgents = list.size());
+    due.clear();
+    moved.clear();
+    scheduler.popDue(ev.time, due);
+    // Agents created while handling this event (by forking, or
+    // for a new phase) are appended after the existing ones
+    size_t existing = list.size();
+    if (!phaseGiven && (ev.time < newAgentTime)) {
+        // A new agent is created for each tempo group in which no
+        // agent accepts the event, so all groups must be visited
         bool created = phaseGiven;
         double prevBeatInterval = -1.0;
-        // cc: Duplicate our list of agents, and scan through the
-        // copy.  This means we can safely add agents to our own
-        // list while scanning without disrupting our scan.  Each
-        // agent needs to be re-added to our own list explicitly
-        // (since it is modified by e.g. considerAsBeat)
-        Container currentAgents = list;
-        list.clear();
-        for (Container::iterator ai = currentAgents.begin();
-             ai != currentAgents.end(); ++ai) {
-            Agent *currentAgent = *ai;
+        for (size_t i = 0; i < existing; ++i) {
+            Agent *currentAgent = list[i];
             if (currentAgent->beatInterval != prevBeatInterval) {
-                if ((prevBeatInterval>=0) && !created && (ev.time<5.0)) {
+                if ((prevBeatInterval>=0) && !created) {
 #ifdef DEBUG_BEATROOT
                     std::cerr << "Creating a new agent" << std::endl;
 #endif
                     // Create new agent with different phase
-                    Agent *newAgent = new Agent(params, prevBeatInterval);
+                    Agent *newAgent = Agent::create(*context, prevBeatInterval);
                     // This may add another agent to our list as well
                     newAgent->considerAsBeat(ev, *this);
-                    add(newAgent);
+                    add(newAgent, false);
                 }
                 prevBeatInterval = currentAgent->beatInterval;
                 created = phaseGiven;
             }
-            if (currentAgent->considerAsBeat(ev, *this))
+            // Agents that are still scheduled are not due yet
+            if (currentAgent->scheduleIndex >= 0)
+                continue;
+            if (currentAgent->considerAsBeat(ev, *this)) {
                 created = true;
-            add(currentAgent);
+                moved.push_back(currentAgent);
+            } else {
+                scheduler.schedule(currentAgent,
+                                   currentAgent->nextWindowTime(ev.time));
+            }
         } // loop for each agent
-        removeDuplicates();
-    } // loop for each event
-} // beatTrack()
+    } else {
+        std::sort(due.begin(), due.end(), agentComparator);
+        judgeAll(ev, due, judgements, pool.get());
+        for (size_t i = 0; i < due.size(); ++i) {
+            Agent *agent = due[i];
+            if (agent->apply(ev, judgements[i], *this)) {
+                moved.push_back(agent);
+            } else {
+                scheduler.schedule(agent, agent->nextWindowTime(ev.time));
+            }
+        } // loop for each due agent
+    }
+    if (due.empty() && list.size() == existing)
+        return; // no agent has changed
+    moved.insert(moved.end(), list.begin() + existing, list.end());
+    if (!moved.empty()) {
+        // Agents that have accepted the event may have changed
+        // tempo, so they are re-sorted along with the new agents
+        // and merged back into the rest of the list, which is
+        // still in order.  Only the moved agents are unscheduled
+        // at this point.
+        staying.clear();
+        for (size_t i = 0; i < existing; ++i) {
+            if (list[i]->scheduleIndex >= 0) staying.push_back(list[i]);
+        }
+        std::sort(moved.begin(), moved.end(), agentComparator);
+        std::merge(staying.begin(), staying.end(),
+                   moved.begin(), moved.end(),
+                   list.begin(), agentComparator);
+        for (Container::iterator ai = moved.begin(); ai != moved.end(); ++ai) {
+            scheduler.schedule(*ai, (*ai)->nextWindowTime(ev.time));
+        }
+    }
+    removeDuplicates();
+    int maxAgents = context->agentParameters.maxAgents;
+    if (maxAgents > 0 && (int)list.size() > maxAgents)
+        prune(maxAgents);
+} // trackEvent()
+
+void AgentList::finishTracking()
+{
+    pool.reset();
+    scheduler.clear();
+} // finishTracking()
+
+void AgentList::adopt(AgentList &other, double time)
+{
+    Container::iterator added = list.insert(list.end(), other.begin(), other.end());
+    other.list.clear();
+    for (Container::iterator ai = added; ai != list.end(); ++ai) {
+        scheduler.schedule(*ai, (*ai)->nextWindowTime(time));
+    }
+    sort();
+    removeDuplicates();
+    int maxAgents = context->agentParameters.maxAgents;
+    if (maxAgents > 0 && (int)list.size() > maxAgents)
+        prune(maxAgents);
+} // adopt()
 
 Agent *AgentList::bestAgent()
 {
@@ -125,7 +411,7 @@ Agent *AgentList::bestAgent()
     for (iterator itr = begin(); itr != end(); ++itr) {
         if ((*itr)->events.empty()) continue;
         double conf = ((*itr)->phaseScore + (*itr)->tempoScore) /
-            (useAverageSalience? (double)(*itr)->beatCount: 1.0);
+            (context->useAverageSalience? (double)(*itr)->beatCount: 1.0);
         if (conf > best) {
             bestAg = *itr;
             best = conf;
@@ -17,15 +17,22 @@
 #define _AGENT_LIST_H_
 
 #include "Agent.h"
+#include "AgentGrid.h"
+#include "AgentScheduler.h"
 #include "Event.h"
+#include "ThreadPool.h"
 
 #include <vector>
 #include <algorithm>
+#include <map>
+#include <memory>
 
 #ifdef DEBUG_BEATROOT
 #include <iostream>
 #endif
 
+class TrackerContext;
+
 /** Class for maintaining the set of all Agents involved in beat tracking a piece of music.
  */
 class AgentList
@@ -37,6 +44,50 @@ public:
 protected:
     Container list;
 
+    /** The tracker in which new Agents are created, and whose
+     *  parameters are used for beat tracking */
+    TrackerContext *context;
+
+    /** The Agents in list, ordered by the time at which they next
+     *  need to be offered an Event (used within beatTrack()). */
+    AgentScheduler scheduler;
+
+    /** Index of the Agents in list by tempo and phase (used within
+     *  removeDuplicates()). */
+    AgentGrid grid;
+
+    /** Whether the Agents were given initial beats (used between
+     *  startTracking() and finishTracking()). */
+    bool phaseGiven;
+
+    /** The time before which a new Agent is created for each tempo
+     *  group in which no Agent accepts an Event, unless phaseGiven
+     *  (used between startTracking() and finishTracking()). */
+    double newAgentTime;
+
+    /** The threads used for judging Events, or NULL if tracking on a
+     *  single thread (used between startTracking() and
+     *  finishTracking()).  The list owns the pool, so it is moved
+     *  rather than copied, and the threads are stopped when the list
+     *  is destroyed, even by an exception thrown during tracking. */
+    std::unique_ptr<ThreadPool> pool;
+
+    /** Working storage for trackEvent() */
+    Container due, moved, staying;
+    std::vector<Agent::Judgement> judgements;
+
+    /** Working storage for prune(): the Agents of each tempo group,
+     *  the index in groups of the initial beat period of each group,
+     *  and the Agents at the rank within their groups at which the
+     *  cap falls */
+    std::vector<Container> groups;
+    std::map<double, size_t> groupIndex;
+    Container candidates;
+
+    /** Working storage for beatTrack(): the total salience of the
+     *  Events after each one, for removeDominated() */
+    std::vector<double> remaining;
+
     static bool agentComparator(const Agent *a, const Agent *b) {
         if (a->beatInterval == b->beatInterval) {
             return a->idNumber < b->idNumber; // ensure stable ordering
@@ -46,6 +97,12 @@ protected:
     }
 
 public:
+    /** Constructor
+     *  @param c The tracker to which the Agents in the list belong
+     */
+    AgentList(TrackerContext &c) :
+        context(&c), phaseGiven(false), newAgentTime(0) { }
+
     // expose some vector methods
     //!!! can we remove these again once the rest of AgentList is implemented?
     bool empty() const { return list.empty(); }
@@ -59,16 +116,25 @@ public:
 #endif
     }
 
-    /** Flag for choice between sum and average beat salience values for Agent scores.
-     *  The use of summed saliences favours faster tempi or lower metrical levels. */
-    static bool useAverageSalience;
-	
     /** For the purpose of removing duplicate agents, the default JND of IBI */
     static const double DEFAULT_BI;
 	
     /** For the purpose of removing duplicate agents, the default JND of phase */
     static const double DEFAULT_BT;
 
+    /** The smallest number of Agents which are tested against an
+     *  Event in parallel, when more than one thread is in use.  Below
+     *  this, waking the threads costs more than it saves. */
+    static const int MIN_PARALLEL_AGENTS;
+
+    /** The default time before which new Agents are created for
+     *  Events in a new phase (see startTracking()) */
+    static const double DEFAULT_NEW_AGENT_TIME;
+
+    /** The number of Events between the calls of removeDominated()
+     *  in beatTrack(), if AgentParameters::pruneDominated is set */
+    static const int DOMINANCE_PERIOD;
+
     /** Inserts newAgent into the list in ascending order of beatInterval */
     void add(Agent *a) {
 	add(a, true);
@@ -107,29 +173,105 @@ public:
      *  @param ptr Points to the Agent which is removed from the list
      */
     void remove(iterator itr) {
+        scheduler.unschedule(*itr);
 	list.erase(itr);
     } // remove()
 
 protected:
+    /** Calls judge() on each of the agents for the given Event,
+     *  sharing them out between the threads of pool if it is not NULL.
+     */
+    void judgeAll(const Event &e, const Container &agents,
+                  std::vector<Agent::Judgement> &judgements,
+                  ThreadPool *pool);
+
     /** Removes Agents from the list which are duplicates of other Agents.
      *  A duplicate is defined by the tempo and phase thresholds
-     *  thresholdBI and thresholdBT respectively.
+     *  thresholdBI and thresholdBT respectively.  The list must
+     *  already be sorted (see sort()).  Takes time linear in the size
+     *  of the list, for a bounded density of Agents in tempo and phase.
      */
     void removeDuplicates();
 
+    /** Removes the Agents with the lowest phaseScore in each tempo
+     *  group (the Agents with the same initial beat period) until at
+     *  most maxAgents remain.  The best Agent of every group is kept
+     *  before the second best of any, and so on.  Takes time linear
+     *  in the size of the list (for a bounded number of groups), by
+     *  partial selection within each group rather than sorting.
+     */
+    void prune(int maxAgents);
+
+    /** Removes the Agents which cannot overtake the best Agent's
+     *  current score (see AgentParameters::pruneDominated).  Each
+     *  Event accepted as a beat adds at most its salience to an
+     *  Agent's score, so none can gain more than the total salience
+     *  of the Events to come.  The best score is taken only from the
+     *  Agents which cannot expire before the horizon, whatever Events
+     *  they accept until then.
+     *  @param remaining The total salience of the Events still to be
+     *     offered to the Agents
+     *  @param horizon The time of the Event at which the next call is
+     *     made (or of the last Event)
+     */
+    void removeDominated(double remaining, double horizon);
+
+    /** Destroys the Agents flagged for deletion by a negative
+     *  phaseScore, keeping the rest in order.
+     *  @return The number of Agents removed */
+    int removeFlagged();
+
 public:
     /** Perform beat tracking on a list of events (onsets).
      *  @param el The list of onsets (or events or peaks) to beat track
      */
-    void beatTrack(EventList el, AgentParameters params) {
-	beatTrack(el, params, -1.0);
+    void beatTrack(const EventList &el) {
+	beatTrack(el, -1.0);
     } // beatTrack()/1
 	
-    /** Perform beat tracking on a list of events (onsets).
+    /** Perform beat tracking on a list of events (onsets).  If the
+     *  tracker's deadline passes first, tracking stops early and the
+     *  tracker is marked as partial (see TrackerContext).
      *  @param el The list of onsets (or events or peaks) to beat track.
      *  @param stop Do not find beats after <code>stop</code> seconds.
      */
-    void beatTrack(EventList el, AgentParameters params, double stop);
+    void beatTrack(const EventList &el, double stop);
+
+    /** Prepares the Agents for beat tracking one event at a time
+     *  with trackEvent().  beatTrack() is equivalent to calling
+     *  startTracking(), trackEvent() for each event in turn, and
+     *  finishTracking().
+     */
+    void startTracking() {
+        startTracking(DEFAULT_NEW_AGENT_TIME);
+    } // startTracking()/0
+
+    /** Prepares the Agents for beat tracking one event at a time
+     *  with trackEvent().
+     *  @param newAgentTime If the Agents have not been given initial
+     *     beats, then for events before this time, an Agent is
+     *     created with the event as its first beat in each tempo
+     *     group in which no Agent accepts the event
+     */
+    void startTracking(double newAgentTime);
+
+    /** Offers an event (onset) to the Agents, as in beatTrack().
+     *  Events must be given in time order.
+     */
+    void trackEvent(const Event &ev);
+
+    /** Releases the resources used between startTracking() and the
+     *  last call to trackEvent().  They are also released if the list
+     *  is destroyed first.
+     */
+    void finishTracking();
+
+    /** Moves the Agents of another list into this one, between
+     *  calls to trackEvent().  Duplicates are then removed.
+     *  @param other A list of Agents that are not being tracked
+     *  @param time The time of the last event given to trackEvent()
+     */
+    void adopt(AgentList &other, double time);
 
     /** Finds the Agent with the highest score in the list, or NULL if beat tracking has failed.
      *  @return The Agent with the highest score
@@ -0,0 +1,92 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+#include "AgentScheduler.h"
+
+void AgentScheduler::clear()
+{
+    for (int i = 0; i < (int)heap.size(); ++i) {
+        heap[i].agent->scheduleIndex = -1;
+    }
+    heap.clear();
+} // clear()
+
+void AgentScheduler::schedule(Agent *a, double time)
+{
+    Entry e;
+    e.time = time;
+    e.agent = a;
+    int index = a->scheduleIndex;
+    if (index < 0) {
+        heap.push_back(e);
+        place(heap.size() - 1, e);
+        siftUp(heap.size() - 1);
+    } else {
+        double prev = heap[index].time;
+        place(index, e);
+        if (time < prev) siftUp(index);
+        else siftDown(index);
+    }
+} // schedule()
+
+void AgentScheduler::unschedule(Agent *a)
+{
+    int index = a->scheduleIndex;
+    if (index < 0) return;
+    a->scheduleIndex = -1;
+    Entry last = heap.back();
+    heap.pop_back();
+    if (index == (int)heap.size()) return;
+    double prev = heap[index].time;
+    place(index, last);
+    if (last.time < prev) siftUp(index);
+    else siftDown(index);
+} // unschedule()
+
+void AgentScheduler::popDue(double time, std::vector<Agent *> &due)
+{
+    while (!heap.empty() && heap[0].time <= time) {
+        Agent *a = heap[0].agent;
+        unschedule(a);
+        due.push_back(a);
+    }
+} // popDue()
+
+void AgentScheduler::siftUp(int index)
+{
+    Entry e = heap[index];
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (heap[parent].time <= e.time) break;
+        place(index, heap[parent]);
+        index = parent;
+    }
+    place(index, e);
+} // siftUp()
+
+void AgentScheduler::siftDown(int index)
+{
+    Entry e = heap[index];
+    int n = heap.size();
+    while (true) {
+        int child = 2 * index + 1;
+        if (child >= n) break;
+        if (child + 1 < n && heap[child + 1].time < heap[child].time) ++child;
+        if (e.time <= heap[child].time) break;
+        place(index, heap[child]);
+        index = child;
+    }
+    place(index, e);
+} // siftDown()
@@ -0,0 +1,74 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+#ifndef _AGENT_SCHEDULER_H_
+#define _AGENT_SCHEDULER_H_
+
+#include "Agent.h"
+
+#include <vector>
+
+/** Priority queue of Agents ordered by the time of the next Event
+ *  which could change their state (see Agent::nextWindowTime()).
+ *  AgentList::beatTrack() uses this to offer each Event only to the
+ *  Agents whose prediction windows may contain it, rather than to
+ *  every Agent in the list.
+ *
+ *  The queue is a binary min-heap; each scheduled Agent records its
+ *  position in the heap in Agent::scheduleIndex, so that an Agent
+ *  can be removed in logarithmic time when it is deleted.
+ */
+class AgentScheduler
+{
+public:
+    bool empty() const { return heap.empty(); }
+    size_t size() const { return heap.size(); }
+
+    /** Removes all Agents from the queue. */
+    void clear();
+
+    /** Adds an Agent to the queue, or moves it if it is already queued.
+     *  @param a The Agent to be scheduled
+     *  @param time The time at which the Agent next needs to see an Event
+     */
+    void schedule(Agent *a, double time);
+
+    /** Removes an Agent from the queue, if it is queued. */
+    void unschedule(Agent *a);
+
+    /** Removes all Agents which are due at or before the given time
+     *  from the queue, appending them (in no particular order) to due.
+     */
+    void popDue(double time, std::vector<Agent *> &due);
+
+protected:
+    struct Entry {
+        double time;
+        Agent *agent;
+    };
+
+    std::vector<Entry> heap;
+
+    void place(int index, const Entry &e) {
+        heap[index] = e;
+        e.agent->scheduleIndex = index;
+    }
+
+    void siftUp(int index);
+    void siftDown(int index);
+
+}; // class AgentScheduler
+
+#endif
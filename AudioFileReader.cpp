@@ -0,0 +1,210 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+#include "AudioFileReader.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static unsigned int le16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned int le32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+AudioFileReader::AudioFileReader() :
+    base(0),
+    size(0),
+    mapped(false),
+    dataOffset(0),
+    released(0),
+    sampleRate(0),
+    frames(0)
+{
+}
+
+AudioFileReader::~AudioFileReader()
+{
+    close();
+}
+
+void AudioFileReader::close()
+{
+#ifndef _WIN32
+    if (mapped) munmap((void *)base, size);
+#endif
+    std::vector<unsigned char>().swap(contents);
+    base = 0;
+    size = 0;
+    mapped = false;
+    dataOffset = 0;
+    released = 0;
+    sampleRate = 0;
+    frames = 0;
+}
+
+bool AudioFileReader::fail(const std::string &message)
+{
+    error = message;
+    close();
+    return false;
+}
+
+bool AudioFileReader::parseEncoding(const std::string &name,
+                                    PCMFormat::Encoding &e)
+{
+    if (name == "s8") e = PCMFormat::PCM8;
+    else if (name == "s16") e = PCMFormat::PCM16;
+    else if (name == "s24") e = PCMFormat::PCM24;
+    else if (name == "s32") e = PCMFormat::PCM32;
+    else if (name == "f32") e = PCMFormat::Float32;
+    else if (name == "f64") e = PCMFormat::Float64;
+    else return false;
+    return true;
+}
+
+bool AudioFileReader::load(const std::string &path)
+{
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return fail("cannot open file");
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *p = mmap(0, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            ::close(fd);
+            base = static_cast<const unsigned char *>(p);
+            size = size_t(st.st_size);
+            mapped = true;
+#ifdef MADV_SEQUENTIAL
+            madvise(p, size, MADV_SEQUENTIAL);
+#endif
+            return true;
+        }
+    }
+    ::close(fd);
+#endif
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) return fail("cannot open file");
+    unsigned char buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        contents.insert(contents.end(), buffer, buffer + n);
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    if (!ok) return fail("cannot read file");
+    base = contents.empty() ? 0 : &contents[0];
+    size = contents.size();
+    return true;
+} // load()
+
+bool AudioFileReader::open(const std::string &path, const RawFormat &raw)
+{
+    close();
+    error = "";
+    if (!load(path)) return false;
+
+    if (size >= 12 && !memcmp(base, "RIFF", 4) && !memcmp(base + 8, "WAVE", 4)) {
+        return readWavHeader();
+    }
+
+    if (!(raw.sampleRate > 0) || raw.format.channels < 1) {
+        return fail("not a WAV file, and no raw format given");
+    }
+    format = raw.format;
+    sampleRate = raw.sampleRate;
+    dataOffset = 0;
+    frames = size / format.getFrameBytes();
+    return true;
+} // open()
+
+bool AudioFileReader::readWavHeader()
+{
+    bool haveFormat = false;
+    size_t pos = 12;
+    while (pos + 8 <= size) {
+        const unsigned char *chunk = base + pos;
+        size_t chunkSize = le32(chunk + 4);
+        pos += 8;
+        if (!memcmp(chunk, "fmt ", 4)) {
+            if (chunkSize < 16 || pos + chunkSize > size) {
+                return fail("bad format chunk");
+            }
+            const unsigned char *fmt = base + pos;
+            unsigned int tag = le16(fmt);
+            format.channels = le16(fmt + 2);
+            sampleRate = float(le32(fmt + 4));
+            int bits = le16(fmt + 14);
+            if (tag == 0xfffe && chunkSize >= 26) {
+                tag = le16(fmt + 24); // from the sub-format GUID
+            }
+            if (tag == 1 && bits == 8) format.encoding = PCMFormat::PCM8;
+            else if (tag == 1 && bits == 16) format.encoding = PCMFormat::PCM16;
+            else if (tag == 1 && bits == 24) format.encoding = PCMFormat::PCM24;
+            else if (tag == 1 && bits == 32) format.encoding = PCMFormat::PCM32;
+            else if (tag == 3 && bits == 32) format.encoding = PCMFormat::Float32;
+            else if (tag == 3 && bits == 64) format.encoding = PCMFormat::Float64;
+            else return fail("unsupported sample format");
+            if (format.channels < 1 || !(sampleRate > 0)) {
+                return fail("bad format chunk");
+            }
+            haveFormat = true;
+        } else if (!memcmp(chunk, "data", 4)) {
+            if (!haveFormat) return fail("data chunk before format chunk");
+            // Streaming encoders may leave the 0xFFFFFFFF placeholder,
+            // or a size that runs past the end of the file: the data
+            // then runs to the end.  Any other size, even zero, holds.
+            size_t available = size - pos;
+            if (chunkSize != 0xffffffff && chunkSize < available) {
+                available = chunkSize;
+            }
+            dataOffset = pos;
+            frames = available / format.getFrameBytes();
+            return true;
+        }
+        pos += chunkSize + (chunkSize & 1);
+    }
+    return fail("no data chunk");
+} // readWavHeader()
+
+void AudioFileReader::release(size_t frame)
+{
+#if !defined(_WIN32) && defined(MADV_DONTNEED)
+    if (!mapped) return;
+    static const size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t end = dataOffset + frame * format.getFrameBytes();
+    if (end > size) end = size;
+    end -= end % pageSize;
+    if (end > released) {
+        // The mapping is read-only, so the pages are simply re-read
+        // from the file should they be needed again
+        madvise((void *)(base + released), end - released, MADV_DONTNEED);
+        released = end;
+    }
+#endif
+} // release()
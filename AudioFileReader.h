@@ -0,0 +1,109 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+#ifndef _AUDIO_FILE_READER_H_
+#define _AUDIO_FILE_READER_H_
+
+#include "PCMFormat.h"
+
+#include <string>
+#include <vector>
+
+/** Gives access to the audio in WAV files or headerless (raw) PCM
+ *  files, in place.  WAV files may hold 8-, 16-, 24- or 32-bit integer
+ *  or 32- or 64-bit float samples; raw files are read as described by
+ *  a RawFormat.  All multi-byte samples are little-endian.
+ *
+ *  The file is memory-mapped for sequential access, and its audio
+ *  read from the mapped pages, so that it is never copied as a whole;
+ *  the pages that have been processed may be given back with
+ *  release().  Where files cannot be mapped (on Windows, or for pipes
+ *  and the like), the file is read into memory instead.
+ */
+class AudioFileReader
+{
+public:
+    /** The layout of a raw PCM file, which has no header to give it */
+    struct RawFormat {
+        RawFormat() : sampleRate(0) { }
+        PCMFormat format;
+        float sampleRate;
+    };
+
+    AudioFileReader();
+    ~AudioFileReader();
+
+    /** Opens a file, closing any file already open.  A file that
+     *  starts with a RIFF WAVE header is read as a WAV file; any other
+     *  file is read as raw PCM in the given format, if its sample rate
+     *  is non-zero.
+     *  @return Whether the file was opened; if not, getError()
+     *     describes the problem
+     */
+    bool open(const std::string &path, const RawFormat &raw);
+
+    void close();
+
+    float getSampleRate() const { return sampleRate; }
+    const PCMFormat &getFormat() const { return format; }
+
+    /** @return The length of the audio in sample frames */
+    size_t getFrameCount() const { return frames; }
+
+    /** @return The audio, as getFrameCount() frames laid out as
+     *  described by getFormat() */
+    const unsigned char *getData() const { return base + dataOffset; }
+
+    /** Indicates that the audio before the given sample frame will not
+     *  be read again, so that the memory holding it can be released. */
+    void release(size_t frame);
+
+    const std::string &getError() const { return error; }
+
+    /** Parses an encoding name (s8, s16, s24, s32, f32 or f64).
+     *  @return Whether the name was recognised */
+    static bool parseEncoding(const std::string &name,
+                              PCMFormat::Encoding &encoding);
+
+protected:
+    /** The whole file, mapped or read into memory */
+    const unsigned char *base;
+    size_t size;
+    bool mapped;
+    std::vector<unsigned char> contents;
+
+    /** The offset of the audio in the file */
+    size_t dataOffset;
+
+    /** The offset up to which the mapped pages have been released */
+    size_t released;
+
+    PCMFormat format;
+    float sampleRate;
+    size_t frames;
+    std::string error;
+
+    bool load(const std::string &path);
+    bool readWavHeader();
+    bool fail(const std::string &message);
+
+private:
+    AudioFileReader(const AudioFileReader &);
+    AudioFileReader &operator=(const AudioFileReader &);
+
+}; // class AudioFileReader
+
+#endif
@@ -15,59 +15,250 @@
 
 #include "BeatRootProcessor.h"
 
-bool
-BeatRootProcessor::silent = true;
-
 void BeatRootProcessor::processFrame(const float *const *inputBuffers) {
-    double flux = 0;
-    for (int i = 0; i <= fftSize/2; i++) {
-        double mag = sqrt(inputBuffers[0][i*2] * inputBuffers[0][i*2] +
-                          inputBuffers[0][i*2+1] * inputBuffers[0][i*2+1]);
-        if (mag > prevFrame[i]) flux += mag - prevFrame[i];
-        prevFrame[i] = mag;
+    BEATROOT_STATS(TrackingStats::Timer timer(context.stats.frameTime));
+    addFlux(computeFlux(inputBuffers[0]));
+} // processFrame()
+
+double BeatRootProcessor::computeFlux(const float *frame) {
+    return SpectralFlux::compute(frame, &prevFrame[0], fftSize/2 + 1);
+} // computeFlux()
+
+double BeatRootProcessor::computeTimeDomainFlux(const float *samples) {
+    fft.forward(samples, &spectrum[0]);
+    return computeFlux(&spectrum[0]);
+} // computeTimeDomainFlux()
+
+void BeatRootProcessor::addFlux(double flux) {
+    ++frameCount;
+
+    if (!causal) {
+        spectralFlux.push_back(flux);
+    } else {
+        // Normalise by the statistics of the flux so far, as
+        // Peaks::normalise() does for the whole of it
+        fluxSum += flux;
+        fluxSquareSum += flux * flux;
+        int n = frameCount;
+        double mean = fluxSum / n;
+        double sd = sqrt((fluxSquareSum - fluxSum * mean) / n);
+        if (!(sd > 0))
+            sd = 1;
+        double value = (flux - mean) / sd;
+        normalisedFlux.push_back(value);
+        if (value < minNormalisedFlux)
+            minNormalisedFlux = value;
+        vector<int> peaks;
+        peakPicker.push(value, peaks);
+        addCausalOnsets(peaks);
     }
     
-    spectralFlux.push_back(flux);
-    
-} // processFrame()
+} // addFlux()
+
+void BeatRootProcessor::processTimeDomainFrame(const float *samples) {
+    BEATROOT_STATS(TrackingStats::Timer timer(context.stats.frameTime));
+    addFlux(computeTimeDomainFlux(samples));
+} // processTimeDomainFrame()
+
+/** Processes each frame of samples with processTimeDomainFrame() */
+class FrameProcessor : public BeatRootProcessor::FrameSink
+{
+public:
+    FrameProcessor(BeatRootProcessor &p) : processor(p) { }
+    void frame(const float *samples) {
+        processor.processTimeDomainFrame(samples);
+    }
+protected:
+    BeatRootProcessor &processor;
+};
+
+void BeatRootProcessor::frameSamples(const float *samples, int count,
+                                     FrameSink &sink) {
+    while (count > 0) {
+        int n = fftSize - audioFill;
+        if (n > count) n = count;
+        for (int i = 0; i < n; i++) audio[audioFill + i] = samples[i];
+        audioFill += n;
+        samples += n;
+        count -= n;
+        if (audioFill == fftSize) {
+            sink.frame(&audio[0]);
+            // Keep the overlap with the next frame
+            for (int i = hopSize; i < fftSize; i++) audio[i - hopSize] = audio[i];
+            audioFill -= hopSize;
+        }
+    }
+} // frameSamples()
+
+void BeatRootProcessor::flushFrames(FrameSink &sink) {
+    // Every frame that starts before the end of the audio is processed
+    while (audioFill > 0) {
+        for (int i = audioFill; i < fftSize; i++) audio[i] = 0;
+        sink.frame(&audio[0]);
+        for (int i = hopSize; i < fftSize; i++) audio[i - hopSize] = audio[i];
+        audioFill -= hopSize;
+    }
+    audioFill = 0;
+} // flushFrames()
+
+void BeatRootProcessor::processSamples(const float *samples, int count) {
+    FrameProcessor sink(*this);
+    frameSamples(samples, count, sink);
+} // processSamples()
+
+void BeatRootProcessor::processTimeDomainFrame(const unsigned char *frame,
+                                               const PCMFormat &format) {
+    BEATROOT_STATS(TrackingStats::Timer timer(context.stats.frameTime));
+    fft.forward(frame, format, &spectrum[0]);
+    addFlux(computeFlux(&spectrum[0]));
+} // processTimeDomainFrame()/PCM
+
+size_t BeatRootProcessor::processPCM(const unsigned char *data, size_t frames,
+                                     const PCMFormat &format, bool atEnd) {
+    size_t frameBytes = format.getFrameBytes();
+    size_t start = 0;
+    for ( ; start + fftSize <= frames; start += hopSize) {
+        processTimeDomainFrame(data + start * frameBytes, format);
+    }
+    if (!atEnd) {
+        return start;
+    }
+    // Only the incomplete frames at the end are converted and copied
+    float block[1024];
+    while (start < frames) {
+        int n = (frames - start < 1024) ? int(frames - start) : 1024;
+        format.toMono(data + start * frameBytes, n, block);
+        processSamples(block, n);
+        start += n;
+    }
+    return frames;
+} // processPCM()
+
+void BeatRootProcessor::flushSamples() {
+    FrameProcessor sink(*this);
+    flushFrames(sink);
+} // flushSamples()
+
+void BeatRootProcessor::addCausalOnsets(const vector<int> &peaks) {
+    for (int i = 0; i < (int)peaks.size(); i++) {
+        Event e = BeatTracker::newBeat(peaks[i] * hopTime, 0);
+        // Note that salience must be non-negative or the beat tracking system fails!
+        e.salience = normalisedFlux[peaks[i] - normalisedBase] - minNormalisedFlux;
+        causalTracker.addOnset(e);
+    }
+    // Discard the values that can no longer be peaks, once there are
+    // enough of them to make it worth moving the rest
+    int unused = frameCount - peakPicker.getLatency() - 1 - normalisedBase;
+    if (unused > 4096 && unused > (int)normalisedFlux.size() / 2) {
+        normalisedFlux.erase(normalisedFlux.begin(),
+                             normalisedFlux.begin() + unused);
+        normalisedBase += unused;
+    }
+} // addCausalOnsets()
+
+EventList BeatRootProcessor::getNewBeats(EventList *unfilledReturn) {
+    EventList beats;
+    if (causal && frameCount > 0) {
+        double now = (frameCount - 1) * hopTime;
+        causalTracker.getBeats(now, beats, unfilledReturn);
+    }
+    return beats;
+} // getNewBeats()
+
+void BeatRootProcessor::findOnsets() {
+    BEATROOT_STATS(TrackingStats::Timer timer(context.stats.onsetTime));
+    onsetList.clear();
+    size_t n = spectralFlux.size();
+    if (n == 0)
+        return;
+    double sx = 0;
+    double sxx = 0;
+    double minFlux = HUGE_VAL;
+    for (size_t i = 0; i < n; i++) {
+        double value = spectralFlux[i];
+        sx += value;
+        sxx += value * value;
+        if (value < minFlux)
+            minFlux = value;
+    }
+    double mean = sx / n;
+    double sd = sqrt((sxx - sx * mean) / n);
+    if (sd == 0)
+        sd = 1;
+    // The normalised values are given to the peak picker a block at
+    // a time, rather than held for the whole input
+    vector<int> peaks;
+    peakPicker.reset();
+    double block[256];
+    for (size_t start = 0; start < n; start += 256) {
+        int count = (n - start < 256) ? int(n - start) : 256;
+        for (int i = 0; i < count; i++) {
+            block[i] = (spectralFlux[start + i] - mean) / sd;
+        }
+        peakPicker.push(block, count, peaks);
+    }
+    peakPicker.finish(peaks);
+    // Note that salience must be non-negative or the beat tracking system fails!
+    double minSalience = (minFlux - mean) / sd;
+    onsetList.reserve(peaks.size());
+    for (size_t i = 0; i < peaks.size(); i++) {
+        Event e = BeatTracker::newBeat(peaks[i] * hopTime, 0);
+        e.salience = (spectralFlux[peaks[i]] - mean) / sd - minSalience;
+        onsetList.push_back(e);
+    }
+} // findOnsets()
+
+vector<TempoHypothesis> BeatRootProcessor::estimateTempo() {
+    flushSamples();
+    if (causal)
+        return causalTracker.getTempoHypotheses();
+    findOnsets();
+    return Induction::tempoHypotheses(context.inductionParameters, onsetList);
+} // estimateTempo()
 
-EventList BeatRootProcessor::beatTrack(EventList *unfilledReturn) {
+EventList BeatRootProcessor::beatTrack(EventList *unfilledReturn,
+                                      vector<TempoHypothesis> *tempoReturn) {
+
+    flushSamples();
+
+    if (causal) {
+        EventList beats;
+        if (frameCount > 0) {
+            vector<int> peaks;
+            peakPicker.finish(peaks);
+            addCausalOnsets(peaks);
+            double end = (frameCount - 1) * hopTime;
+            causalTracker.finish(end, beats, unfilledReturn);
+        }
+        if (tempoReturn) *tempoReturn = causalTracker.getTempoHypotheses();
+        return beats;
+    }
 
 #ifdef DEBUG_BEATROOT
     std::cerr << "Spectral flux:" << std::endl;
-    for (int i = 0; i < spectralFlux.size(); ++i) {
+    for (size_t i = 0; i < spectralFlux.size(); ++i) {
         if ((i % 8) == 0) std::cerr << "\n";
         std::cerr << spectralFlux[i] << " ";
     }
 #endif
-		
-    double hop = hopTime;
-    Peaks::normalise(spectralFlux);
-    vector<int> peaks = Peaks::findPeaks(spectralFlux, (int)lrint(0.06 / hop), 0.35, 0.84, true);
-    onsets.clear();
-    onsets.resize(peaks.size(), 0);
-    vector<int>::iterator it = peaks.begin();
-    onsetList.clear();
-    double minSalience = Peaks::min(spectralFlux);
-    for (int i = 0; i < (int)onsets.size(); i++) {
-        int index = *it;
-        ++it;
-        onsets[i] = index * hop;
-        Event e = BeatTracker::newBeat(onsets[i], 0);
-//			if (debug)
-//				System.err.printf("Onset: %8.3f  %8.3f  %8.3f\n",
-//						onsets[i], energy[index], slope[index]);
-//			e.salience = slope[index];	// or combination of energy + slope??
-        // Note that salience must be non-negative or the beat tracking system fails!
-        e.salience = spectralFlux[index] - minSalience;
-        onsetList.push_back(e);
-    }
+
+    findOnsets();
 
 #ifdef DEBUG_BEATROOT
     std::cerr << "Onsets: " << onsetList.size() << std::endl;
 #endif
 
-    return BeatTracker::beatTrack(agentParameters, onsetList, unfilledReturn);
+    if (tempoReturn)
+        *tempoReturn = Induction::tempoHypotheses(context.inductionParameters,
+                                                  onsetList);
+
+    if (segmentLength > 0) {
+        return SegmentedBeatTracker::beatTrack(context, onsetList,
+                                               segmentLength, segmentOverlap,
+                                               unfilledReturn);
+    }
+
+    return BeatTracker::beatTrack(context, onsetList, unfilledReturn);
 
 } // processFile()
 
@@ -17,8 +17,14 @@
 #define _BEATROOT_PROCESSOR_H_
 
 #include "Peaks.h"
+#include "OnsetFunction.h"
+#include "PeakPicker.h"
+#include "SpectralFlux.h"
+#include "RealFFT.h"
 #include "Event.h"
 #include "BeatTracker.h"
+#include "CausalBeatTracker.h"
+#include "SegmentedBeatTracker.h"
 
 #include <vector>
 #include <cmath>
@@ -40,8 +46,10 @@ protected:
     float sampleRate;
 	
     /** Spacing of audio frames (determines the amount of overlap or
-     *  skip between frames). This value is expressed in
-     *  seconds. (Default = 0.020s) */
+     *  skip between frames). This value is expressed in seconds.
+     *  (Default = 0.010s, adjusted so that <code>hopSize</code> is a
+     *  whole number of samples, which it is not at every sample
+     *  rate.) */
     double hopTime;
 
     /** The approximate size of an FFT frame in seconds. (Default =
@@ -55,8 +63,12 @@ protected:
     /** The size of an FFT frame in samples (see <code>fftTime</code>) */
     int fftSize;
 
-    /** Spectral flux onset detection function, indexed by frame. */
-    vector<double> spectralFlux;
+    /** Spectral flux onset detection function, indexed by frame
+     *  (batch mode only; see setCompact()). */
+    OnsetFunction spectralFlux;
+
+    /** The number of frames processed */
+    int frameCount;
 	
     /** A mapping function for mapping FFT bins to final frequency bins.
      *  The mapping is linear (1-1) until the resolution reaches 2 points per
@@ -72,21 +84,63 @@ protected:
     int freqMapSize;
 
     /** The magnitude spectrum of the most recent frame.  Used for
-     *  calculating the spectral flux. */
-    vector<double> prevFrame;
+     *  calculating the spectral flux (see SpectralFlux). */
+    vector<float> prevFrame;
+
+    /** The transform of time-domain frames, and the spectrum of the
+     *  frame being processed (see processTimeDomainFrame()) */
+    RealFFT fft;
+    vector<float> spectrum;
+
+    /** Samples given to processSamples() for the next frame, of
+     *  which audioFill have arrived */
+    vector<float> audio;
+    int audioFill;
 
     /** The estimated onset times from peak-picking the onset
-     * detection function(s). */
-    vector<double> onsets;
-	
-    /** The estimated onset times and their saliences. */	
+     *  detection function, and their saliences. */
     EventList onsetList;
     
-    /** User-specifiable processing parameters. */
-    AgentParameters agentParameters;
+    /** The beat tracker, with its user-specifiable processing
+     *  parameters. */
+    TrackerContext context;
 	
     /** Flag for suppressing all standard output messages except results. */
-    static bool silent;
+    bool silent;
+
+    /** Whether onsets are detected and beats tracked as each frame
+     *  is processed (see setCausal()). */
+    bool causal;
+
+    /** Running sums of the spectral flux and its square, for
+     *  normalising it in causal mode. */
+    double fluxSum;
+    double fluxSquareSum;
+
+    /** The spectral flux normalised by the mean and standard
+     *  deviation of the flux up to each frame (causal mode only),
+     *  from frame normalisedBase onwards, and its minimum so far.
+     *  Only the frames that the peak picker may yet report as onsets
+     *  need to be kept. */
+    vector<double> normalisedFlux;
+    int normalisedBase;
+    double minNormalisedFlux;
+
+    /** Whether the onset detection function is stored compactly
+     *  (see setCompact()). */
+    bool compact;
+
+    /** The length and overlap of the segments in which beats are
+     *  tracked in batch mode, or zero to track the whole input at
+     *  once (see setSegmented()). */
+    double segmentLength;
+    double segmentOverlap;
+
+    /** Onset detection in causal mode */
+    PeakPicker peakPicker;
+
+    /** Beat tracking in causal mode */
+    CausalBeatTracker causalTracker;
 	
 public:
 
@@ -97,11 +151,22 @@ public:
         hopTime(0.010),
         fftTime(0.04644),
         hopSize(0),
-        fftSize(0),
-        agentParameters(parameters)
+        fftSize(lrint(pow(2, lrint(log(fftTime * sr) / log(2))))),
+        fft(fftSize),
+        spectrum(fftSize + 2),
+        audio(fftSize),
+        context(parameters),
+        silent(true),
+        causal(false),
+        compact(false),
+        segmentLength(0),
+        segmentOverlap(0),
+        peakPicker((int)lrint(0.06 / hopTime), 0.35, 0.84, true),
+        causalTracker(context, CausalBeatTracker::DEFAULT_LOOKAHEAD)
     {
         hopSize = lrint(sampleRate * hopTime);
-        fftSize = lrint(pow(2, lrint( log(fftTime * sampleRate) / log(2))));
+        // Frame times are those of the hop actually taken
+        hopTime = hopSize / double(sampleRate);
         init();
     } // constructor
 
@@ -109,6 +174,95 @@ public:
         init();
     }
 
+    /** Sets the beat tracking parameters for subsequent tracking. */
+    void setParameters(const AgentParameters &parameters) {
+        context.agentParameters = parameters;
+    }
+
+    /** Sets the tempo induction parameters for subsequent tracking,
+     *  including the method by which they are found. */
+    void setInductionParameters(const InductionParameters &parameters) {
+        context.inductionParameters = parameters;
+    }
+
+    float getSampleRate() const { return sampleRate; }
+
+    /** @return The counters of the work done since the processor was
+     *  created or reset, which are updated only if the library is
+     *  built with BEATROOT_ENABLE_STATS (see TrackingStats). */
+    const TrackingStats &getStats() const { return context.stats; }
+
+    /** Adds the counts and times of work done for the processor
+     *  outside it (by the stages of a Pipeline) to those returned by
+     *  getStats(). */
+    void addStats(const TrackingStats &s) { context.stats.add(s); }
+
+    /** Sets the point at which beatTrack() stops tracking early and
+     *  returns the beats found so far (see Deadline).  It applies in
+     *  batch mode only, to every later call of beatTrack() until it
+     *  is set again. */
+    void setDeadline(const Deadline &d) { context.deadline = d; }
+
+    /** @return Whether the latest call of beatTrack() was stopped
+     *  early by the deadline, so that its beats cover only the start
+     *  of the input */
+    bool isPartial() const { return context.partial; }
+
+    /** Selects causal (real-time) processing, in which onsets are
+     *  detected and beats tracked as each frame is processed, and
+     *  beats are returned by getNewBeats() during processing, or
+     *  batch processing (the default), in which all the work is done
+     *  by beatTrack() at the end.  Unless the parameters give a
+     *  decayFactor, causal mode decays the Agents' scores by
+     *  AgentParameters::DEFAULT_CAUSAL_DECAY_FACTOR, so that a change
+     *  in the music can displace the best Agent.
+     *  @param lookahead In causal mode, the time in seconds by which
+     *     the beats returned by getNewBeats() lag the latest frame
+     */
+    void setCausal(bool c, double lookahead) {
+        causal = c;
+        context.causal = c;
+        causalTracker.setLookahead(lookahead);
+    }
+
+    bool isCausal() const { return causal; }
+
+    /** Selects compact storage of the onset detection function in
+     *  batch mode, in which it takes half the memory, but the beats
+     *  found may differ slightly from those of full storage (see
+     *  OnsetFunction).  Takes effect immediately if no frames have
+     *  been processed, otherwise from the next reset().
+     */
+    void setCompact(bool c) {
+        compact = c;
+        if (frameCount == 0) spectralFlux.setCompact(c);
+    }
+
+    /** @return The number of bytes of memory occupied by the onset
+     *  detection function and the onsets.  In batch mode this grows
+     *  with the length of the input, by 2.88MB per hour (1.44MB in
+     *  compact mode) for the onset detection function, plus 24 bytes
+     *  per onset, typically under 0.5MB per hour.  In causal mode it
+     *  does not grow.
+     */
+    size_t getMemoryUsage() const {
+        return spectralFlux.getMemoryUsage() +
+            onsetList.capacity() * sizeof(Event) +
+            normalisedFlux.capacity() * sizeof(double);
+    }
+
+    /** Selects the tracking of beats in overlapping segments, in
+     *  parallel (see SegmentedBeatTracker), for very long inputs in
+     *  batch mode.
+     *  @param length The length of each segment in seconds, or zero
+     *     to track the whole input at once (the default)
+     *  @param overlap The overlap between segments in seconds
+     */
+    void setSegmented(double length, double overlap) {
+        segmentLength = length;
+        segmentOverlap = overlap;
+    }
+
     /** Processes a frame of frequency-domain audio data by mapping
      *  the frequency bins into a part-linear part-logarithmic array,
      *  then computing the spectral flux then (optionally) normalising
@@ -116,9 +270,119 @@ public:
      */
     void processFrame(const float *const *inputBuffers);
 
-    /** Tracks beats once all frames have been processed by processFrame
+    /** Processes a frame of time-domain audio data, of getFFTSize()
+     *  samples, as processFrame() does its Hann-windowed Fourier
+     *  transform.  Frames are expected at intervals of getHopSize()
+     *  samples; the time of each is taken to be that of its centre.
+     */
+    void processTimeDomainFrame(const float *samples);
+
+    /** Processes mono PCM audio given in blocks of any length,
+     *  dividing it into frames of getFFTSize() samples at intervals of
+     *  getHopSize() samples starting from the first sample, which are
+     *  processed by processTimeDomainFrame().  The frames remaining at
+     *  the end of the audio are zero-padded and processed by
+     *  beatTrack().
+     */
+    void processSamples(const float *samples, int count);
+
+    /** Processes a frame of PCM audio, of getFFTSize() sample frames,
+     *  as processTimeDomainFrame() does, converting it to mono as it
+     *  is transformed.
      */
-    EventList beatTrack(EventList *optionalUnfilledBeatReturn);
+    void processTimeDomainFrame(const unsigned char *frame,
+                                const PCMFormat &format);
+
+    /** Processes PCM audio in place, such as a memory-mapped file,
+     *  reading each frame directly from it.  Frames are taken at
+     *  intervals of getHopSize() sample frames starting from the
+     *  first, as long as they are complete; the audio may be given
+     *  over several calls, each starting from where the previous
+     *  one's frames ended.
+     *  @param data The audio
+     *  @param frames The number of sample frames of audio
+     *  @param format The layout of the audio
+     *  @param atEnd Whether this is the end of the audio, in which case
+     *     the remaining frames are processed, zero-padded, by beatTrack()
+     *  @return The number of sample frames consumed, which is the
+     *     offset of the next frame to be processed, or frames if atEnd
+     */
+    size_t processPCM(const unsigned char *data, size_t frames,
+                      const PCMFormat &format, bool atEnd);
+
+    /** Receives the frames into which frameSamples() divides the
+     *  audio. */
+    class FrameSink
+    {
+    public:
+        virtual ~FrameSink() { }
+        /** Called for each frame, of getFFTSize() samples, in order */
+        virtual void frame(const float *samples) = 0;
+    };
+
+    /** Divides mono audio given in blocks of any length into frames,
+     *  as processSamples() does, passing each frame to sink as soon
+     *  as it is complete.  This is the framing of processSamples(),
+     *  which the flux stage of a Pipeline shares.
+     */
+    void frameSamples(const float *samples, int count, FrameSink &sink);
+
+    /** Passes the frames remaining in the audio given to
+     *  frameSamples(), zero-padded, to sink: every frame which starts
+     *  before the end of the audio. */
+    void flushFrames(FrameSink &sink);
+
+    /** The processing of a frame is done in two halves, which may be
+     *  run on different threads at the same time (see Pipeline): the
+     *  framing of the audio by frameSamples() and flushFrames() and
+     *  the calculation of its spectral flux by computeFlux() or
+     *  computeTimeDomainFlux(), and the detection of onsets (and in
+     *  causal mode, tracking of beats) by addFlux().  The two use
+     *  separate parts of the processor's state.  Each must be called
+     *  for the frames in order, by one thread at a time.
+     */
+
+    /** Calculates the spectral flux of a frame of frequency-domain
+     *  audio data, given in the form of processFrame()'s input. */
+    double computeFlux(const float *frame);
+
+    /** Calculates the spectral flux of a frame of time-domain audio
+     *  data, given in the form of processTimeDomainFrame()'s input. */
+    double computeTimeDomainFlux(const float *samples);
+
+    /** Adds the spectral flux of the next frame to the onset
+     *  detection function. */
+    void addFlux(double flux);
+
+    /** In causal mode, returns the beats found since the last call,
+     *  up to the lookahead before the latest frame processed.
+     */
+    EventList getNewBeats(EventList *optionalUnfilledBeatReturn);
+
+    /** Tracks beats once all frames have been processed by
+     *  processFrame.  In causal mode, returns those beats not already
+     *  returned by getNewBeats().  In batch mode, if the deadline
+     *  passes, returns the beats found until then (see isPartial()).
+     *  @param optionalTempoReturn If not NULL, returns the tempo
+     *     hypotheses, best first, found on the same onsets as the beats
+     *     (in batch mode, those estimateTempo() would return; in causal
+     *     mode, those of the latest tempo induction).
+     */
+    EventList beatTrack(EventList *optionalUnfilledBeatReturn,
+                        vector<TempoHypothesis> *optionalTempoReturn = 0);
+
+    /** Estimates the tempo once all frames have been processed, by
+     *  tempo induction on the onsets alone, without tracking beats,
+     *  which takes a small fraction of the time that beatTrack()
+     *  does.  Only the frames given are used, so the estimate may be
+     *  made from the start of the audio alone.  Where the beats are
+     *  tracked as well, beatTrack() can return the same hypotheses
+     *  without finding the onsets again.  In causal mode, returns the
+     *  hypotheses of the latest tempo induction.
+     *  @return The tempo hypotheses, best first (see
+     *     Induction::tempoHypotheses())
+     */
+    vector<TempoHypothesis> estimateTempo();
 
 protected:
     /** Allocates or re-allocates memory for arrays, based on parameter settings */
@@ -129,11 +393,34 @@ protected:
         makeFreqMap(fftSize, sampleRate);
         prevFrame.clear();
         for (int i = 0; i <= fftSize/2; i++) prevFrame.push_back(0);
-        spectralFlux.clear();
-        onsets.clear();
-        onsetList.clear();
+        audioFill = 0;
+        spectralFlux.setCompact(compact);
+        frameCount = 0;
+        EventList().swap(onsetList);
+        fluxSum = 0;
+        fluxSquareSum = 0;
+        normalisedFlux.clear();
+        normalisedBase = 0;
+        minNormalisedFlux = HUGE_VAL;
+        peakPicker.reset();
+        causalTracker.reset();
+        context.stats.clear();
+        context.partial = false;
     } // init()
 
+    /** Processes the frames remaining in the audio given to
+     *  processSamples(), zero-padded. */
+    void flushSamples();
+
+    /** Adds the onsets at the given frames of normalisedFlux to the
+     *  causal beat tracker. */
+    void addCausalOnsets(const vector<int> &peaks);
+
+    /** Normalises the onset detection function and picks its peaks,
+     *  as Peaks::normalise() and Peaks::findPeaks() would, a block at
+     *  a time, giving the onsets in onsetList (batch mode). */
+    void findOnsets();
+
     /** Creates a map of FFT frequency bins to comparison bins.
      *  Where the spacing of FFT bins is less than 0.5 semitones, the mapping is
      *  one to one. Where the spacing is greater than 0.5 semitones, the FFT
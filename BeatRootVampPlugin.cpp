@@ -15,14 +15,24 @@
 
 #include "BeatRootVampPlugin.h"
 #include "BeatRootProcessor.h"
+#include "Reframer.h"
 
 #include "Event.h"
+#include "beatroot.h"
 
 #include <vamp-sdk/RealTime.h>
 #include <vamp-sdk/PluginAdapter.h>
 
-BeatRootVampPlugin::BeatRootVampPlugin(float inputSampleRate) :
+#include <cstdio>
+
+BeatRootVampPlugin::BeatRootVampPlugin(float inputSampleRate, bool timeDomain) :
     Plugin(inputSampleRate),
+    m_timeDomain(timeDomain),
+    m_reframer(0),
+    m_causal(false),
+    m_lookahead(CausalBeatTracker::DEFAULT_LOOKAHEAD),
+    m_tempoOnly(false),
+    m_tempoDuration(0),
     m_firstFrame(true)
 {
     m_processor = new BeatRootProcessor(inputSampleRate, AgentParameters());
@@ -30,24 +40,30 @@ BeatRootVampPlugin::BeatRootVampPlugin(float inputSampleRate) :
 
 BeatRootVampPlugin::~BeatRootVampPlugin()
 {
+    delete m_reframer;
     delete m_processor;
 }
 
 string
 BeatRootVampPlugin::getIdentifier() const
 {
+    if (m_timeDomain) return "beatroot-td";
     return "beatroot";
 }
 
 string
 BeatRootVampPlugin::getName() const
 {
+    if (m_timeDomain) return "BeatRoot Beat Tracker (Time Domain)";
     return "BeatRoot Beat Tracker";
 }
 
 string
 BeatRootVampPlugin::getDescription() const
 {
+    if (m_timeDomain) {
+        return "Identify beat locations in music, from time-domain input which is transformed by the plugin rather than the host";
+    }
     return "Identify beat locations in music";
 }
 
@@ -62,7 +78,7 @@ BeatRootVampPlugin::getPluginVersion() const
 {
     // Increment this each time you release a version that behaves
     // differently from the previous one
-    return 1;
+    return 2;
 }
 
 string
@@ -74,7 +90,7 @@ BeatRootVampPlugin::getCopyright() const
 BeatRootVampPlugin::InputDomain
 BeatRootVampPlugin::getInputDomain() const
 {
-    return FrequencyDomain;
+    return m_timeDomain ? TimeDomain : FrequencyDomain;
 }
 
 size_t
@@ -144,6 +160,86 @@ BeatRootVampPlugin::getParameterDescriptors() const
     desc.isQuantized = false;
     list.push_back(desc);
 
+    desc.identifier = "threads";
+    desc.name = "Worker Threads";
+    desc.description = "The number of threads used to test onsets against the beat tracking agents' predictions. This affects only the speed of tracking, not its results.";
+    desc.minValue = 1;
+    desc.maxValue = BEATROOT_MAX_THREADS;
+    desc.defaultValue = AgentParameters::DEFAULT_THREAD_COUNT;
+    desc.isQuantized = true;
+    desc.quantizeStep = 1;
+    list.push_back(desc);
+
+    desc.identifier = "maxAgents";
+    desc.name = "Maximum Agents";
+    desc.description = "If non-zero, the largest number of beat tracking agents kept at once. Beyond it, the lowest-scoring agents at each tempo are removed, which bounds the time taken on noisy or syncopated music, at some risk to the beats found.";
+    desc.minValue = 0;
+    desc.maxValue = 1000;
+    desc.defaultValue = AgentParameters::DEFAULT_MAX_AGENTS;
+    desc.isQuantized = true;
+    desc.quantizeStep = 1;
+    list.push_back(desc);
+
+    desc.identifier = "pruneDominated";
+    desc.name = "Prune Hopeless Agents";
+    desc.description = "Remove the beat tracking agents whose scores could no longer overtake the best agent's, even if they found a beat at every onset still to come. This saves time without changing the beats found, unless the best agent later gives up for lack of beats. It has no effect in causal tracking or with a score decay.";
+    desc.minValue = 0;
+    desc.maxValue = 1;
+    desc.defaultValue = AgentParameters::DEFAULT_PRUNE_DOMINATED ? 1 : 0;
+    desc.isQuantized = true;
+    desc.quantizeStep = 1;
+    list.push_back(desc);
+
+    desc.identifier = "causal";
+    desc.name = "Causal Tracking";
+    desc.description = "Track beats in real time, returning each beat from the processing call for the audio block that follows it by the lookahead time, rather than finding all the beats at the end.";
+    desc.minValue = 0;
+    desc.maxValue = 1;
+    desc.defaultValue = 0;
+    desc.isQuantized = true;
+    desc.quantizeStep = 1;
+    list.push_back(desc);
+
+    desc.identifier = "lookahead";
+    desc.name = "Lookahead";
+    desc.description = "In causal tracking, the delay in seconds after which a beat is returned. A beat that has not yet been confirmed by an onset is returned as predicted.";
+    desc.unit = "s";
+    desc.minValue = 0;
+    desc.maxValue = 2;
+    desc.defaultValue = CausalBeatTracker::DEFAULT_LOOKAHEAD;
+    desc.isQuantized = false;
+    list.push_back(desc);
+
+    desc.identifier = "decayFactor";
+    desc.name = "Score Decay";
+    desc.description = "If non-zero, the number of recent beats over which each beat tracking agent's score is averaged, rather than summed over the whole piece. This lets causal tracking follow changes in the music. Zero gives the default: a decay over the last 400 or so beats in causal tracking, and whole-piece sums otherwise.";
+    desc.unit = "";
+    desc.minValue = 0;
+    desc.maxValue = 1000;
+    desc.defaultValue = AgentParameters::DEFAULT_DECAY_FACTOR;
+    desc.isQuantized = false;
+    list.push_back(desc);
+
+    desc.identifier = "tempoOnly";
+    desc.name = "Tempo Only";
+    desc.description = "Estimate only the tempo, by tempo induction on the onsets, without tracking the beats, which takes a small fraction of the time. The beat outputs are then empty.";
+    desc.minValue = 0;
+    desc.maxValue = 1;
+    desc.defaultValue = 0;
+    desc.isQuantized = true;
+    desc.quantizeStep = 1;
+    list.push_back(desc);
+
+    desc.identifier = "tempoDuration";
+    desc.name = "Tempo Analysis Duration";
+    desc.description = "When estimating only the tempo, the length in seconds of audio from the start from which it is estimated; the rest is ignored. Zero for the whole of the audio.";
+    desc.unit = "s";
+    desc.minValue = 0;
+    desc.maxValue = 600;
+    desc.defaultValue = 0;
+    desc.isQuantized = false;
+    list.push_back(desc);
+
     // Simon says...
 
     // These are the parameters that should be exposed (Agent.cpp):
@@ -180,6 +276,22 @@ BeatRootVampPlugin::getParameter(string identifier) const
         return m_parameters.maxChange;
     } else if (identifier == "expiryTime") {
         return m_parameters.expiryTime;
+    } else if (identifier == "threads") {
+        return m_parameters.threadCount;
+    } else if (identifier == "maxAgents") {
+        return m_parameters.maxAgents;
+    } else if (identifier == "pruneDominated") {
+        return m_parameters.pruneDominated ? 1 : 0;
+    } else if (identifier == "causal") {
+        return m_causal ? 1 : 0;
+    } else if (identifier == "lookahead") {
+        return m_lookahead;
+    } else if (identifier == "decayFactor") {
+        return m_parameters.decayFactor;
+    } else if (identifier == "tempoOnly") {
+        return m_tempoOnly ? 1 : 0;
+    } else if (identifier == "tempoDuration") {
+        return m_tempoDuration;
     }
     
     return 0;
@@ -196,6 +308,22 @@ BeatRootVampPlugin::setParameter(string identifier, float value)
         m_parameters.maxChange = value;
     } else if (identifier == "expiryTime") {
         m_parameters.expiryTime = value;
+    } else if (identifier == "threads") {
+        m_parameters.threadCount = lrintf(value);
+    } else if (identifier == "maxAgents") {
+        m_parameters.maxAgents = lrintf(value);
+    } else if (identifier == "pruneDominated") {
+        m_parameters.pruneDominated = (value > 0.5);
+    } else if (identifier == "causal") {
+        m_causal = (value > 0.5);
+    } else if (identifier == "lookahead") {
+        m_lookahead = value;
+    } else if (identifier == "decayFactor") {
+        m_parameters.decayFactor = value;
+    } else if (identifier == "tempoOnly") {
+        m_tempoOnly = (value > 0.5);
+    } else if (identifier == "tempoDuration") {
+        m_tempoDuration = value;
     }
 }
 
@@ -244,6 +372,47 @@ BeatRootVampPlugin::getOutputDescriptors() const
     d.description = "Locations of detected beats, before agent interpolation occurs";
     list.push_back(d);
 
+    d.identifier = "tempo";
+    d.name = "Tempo";
+    d.description = "The tempo found by tempo induction, as a single value at the start of the audio (in causal tracking, that of the latest induction)";
+    d.unit = "bpm";
+    d.binCount = 1;
+    list.push_back(d);
+
+    d.identifier = "tempi";
+    d.name = "Tempo Hypotheses";
+    d.description = "The tempo hypotheses found by tempo induction, best first, with their scores, labelled by rank (in causal tracking, those of the latest induction)";
+    d.unit = "";
+    d.binCount = 2;
+    d.binNames.push_back("Tempo");
+    d.binNames.push_back("Score");
+    list.push_back(d);
+
+    // Only in a build that counts them (see TrackingStats)
+    if (TrackingStats::isEnabled()) {
+        d.identifier = "stats";
+        d.name = "Tracking Statistics";
+        d.description = "Counters of the work done in finding the beats, as a single set of values at the start of the audio, with times in seconds";
+        d.binNames.clear();
+        d.binNames.push_back("Induced agents");
+        d.binNames.push_back("Forks");
+        d.binNames.push_back("Expired agents");
+        d.binNames.push_back("Duplicate agents");
+        d.binNames.push_back("Onsets");
+        d.binNames.push_back("Peak agents");
+        d.binNames.push_back("Mean agents");
+        d.binNames.push_back("Considered per onset");
+        d.binNames.push_back("Frame time");
+        d.binNames.push_back("Onset time");
+        d.binNames.push_back("Induction time");
+        d.binNames.push_back("Tracking time");
+        d.binNames.push_back("Fill time");
+        d.binNames.push_back("Pruned agents");
+        d.binNames.push_back("Dominated agents");
+        d.binCount = d.binNames.size();
+        list.push_back(d);
+    }
+
     return list;
 }
 
@@ -257,19 +426,10 @@ BeatRootVampPlugin::initialise(size_t channels, size_t stepSize, size_t blockSiz
 	return false;
     }
 
-    if (stepSize != getPreferredStepSize()) {
-	std::cerr << "BeatRootVampPlugin::initialise: Unsupported step size "
-		  << "for sample rate (" << stepSize << ", required step is "
-		  << getPreferredStepSize() << " for rate " << m_inputSampleRate
-		  << ")" << std::endl;
-	return false;
-    }
-
-    if (blockSize != getPreferredBlockSize()) {
-	std::cerr << "BeatRootVampPlugin::initialise: Unsupported block size "
-		  << "for sample rate (" << blockSize << ", required size is "
-		  << getPreferredBlockSize() << " for rate " << m_inputSampleRate
-		  << ")" << std::endl;
+    if (stepSize < 1 || blockSize < 2) {
+	std::cerr << "BeatRootVampPlugin::initialise: Unsupported step size ("
+		  << stepSize << ") or block size (" << blockSize << ")"
+		  << std::endl;
 	return false;
     }
 
@@ -278,6 +438,12 @@ BeatRootVampPlugin::initialise(size_t channels, size_t stepSize, size_t blockSiz
     // with one using the actual parameters we have
     delete m_processor;
     m_processor = new BeatRootProcessor(m_inputSampleRate, m_parameters);
+    m_processor->setCausal(m_causal && !m_tempoOnly, m_lookahead);
+
+    // Frames of other sizes than the preferred ones are converted to
+    // those the processor expects
+    delete m_reframer;
+    m_reframer = new Reframer(m_processor, m_timeDomain, stepSize, blockSize);
 
     return true;
 }
@@ -286,6 +452,7 @@ void
 BeatRootVampPlugin::reset()
 {
     m_processor->reset();
+    if (m_reframer) m_reframer->reset();
     m_firstFrame = true;
     m_origin = Vamp::RealTime::zeroTime;
 }
@@ -295,19 +462,108 @@ BeatRootVampPlugin::process(const float *const *inputBuffers, Vamp::RealTime tim
 {
     if (m_firstFrame) {
         m_origin = timestamp;
+        if (m_timeDomain) {
+            // Frame times are those of their centres, as the host
+            // reports them for frequency-domain input
+            m_origin = m_origin + Vamp::RealTime::frame2RealTime
+                (m_processor->getFFTSize() / 2, lrintf(m_inputSampleRate));
+        }
         m_firstFrame = false;
     }
 
-    m_processor->processFrame(inputBuffers);
-    return FeatureSet();
+    if (m_tempoOnly && m_tempoDuration > 0 &&
+        timestamp - m_origin > Vamp::RealTime::fromSeconds(m_tempoDuration)) {
+        return FeatureSet();
+    }
+
+    m_reframer->process(inputBuffers[0]);
+
+    if (!m_processor->isCausal()) {
+        return FeatureSet();
+    }
+
+    EventList unfilled;
+    EventList el = m_processor->getNewBeats(&unfilled);
+    return makeFeatures(el, unfilled);
 }
 
 BeatRootVampPlugin::FeatureSet
 BeatRootVampPlugin::getRemainingFeatures()
 {
-    EventList unfilled;
-    EventList el = m_processor->beatTrack(&unfilled);
+    FeatureSet fs;
+    vector<TempoHypothesis> hypotheses;
+    if (m_tempoOnly) {
+        hypotheses = m_processor->estimateTempo();
+    } else {
+        EventList unfilled;
+        EventList el = m_processor->beatTrack(&unfilled, &hypotheses);
+        fs = makeFeatures(el, unfilled);
+    }
+    addTempoFeatures(fs, hypotheses);
+    if (TrackingStats::isEnabled()) {
+        addStatsFeature(fs);
+    }
+    return fs;
+}
 
+void
+BeatRootVampPlugin::addStatsFeature(FeatureSet &fs)
+{
+    const TrackingStats &stats = m_processor->getStats();
+
+    Feature f;
+    f.hasTimestamp = true;
+    f.timestamp = m_origin;
+    f.hasDuration = false;
+    f.values.push_back(float(stats.inducedAgents));
+    f.values.push_back(float(stats.forks));
+    f.values.push_back(float(stats.expired));
+    f.values.push_back(float(stats.duplicates));
+    f.values.push_back(float(stats.onsets));
+    f.values.push_back(float(stats.peakAgents));
+    f.values.push_back(float(stats.getMeanAgents()));
+    f.values.push_back(float(stats.getConsideredPerOnset()));
+    f.values.push_back(float(stats.frameTime));
+    f.values.push_back(float(stats.onsetTime));
+    f.values.push_back(float(stats.inductionTime));
+    f.values.push_back(float(stats.trackingTime));
+    f.values.push_back(float(stats.fillTime));
+    f.values.push_back(float(stats.pruned));
+    f.values.push_back(float(stats.dominated));
+    fs[4].push_back(f);
+}
+
+void
+BeatRootVampPlugin::addTempoFeatures(FeatureSet &fs,
+                                     const vector<TempoHypothesis> &hypotheses)
+{
+    Feature f;
+    f.hasTimestamp = true;
+    f.timestamp = m_origin;
+    f.hasDuration = false;
+
+    for (size_t i = 0; i < hypotheses.size(); ++i) {
+        float bpm = float(60.0 / hypotheses[i].beatInterval);
+        char label[32];
+        if (i == 0) {
+            snprintf(label, sizeof(label), "%.1f bpm", bpm);
+            f.label = label;
+            f.values.clear();
+            f.values.push_back(bpm);
+            fs[2].push_back(f);
+        }
+        snprintf(label, sizeof(label), "%d", int(i + 1));
+        f.label = label;
+        f.values.clear();
+        f.values.push_back(bpm);
+        f.values.push_back(float(hypotheses[i].score));
+        fs[3].push_back(f);
+    }
+}
+
+BeatRootVampPlugin::FeatureSet
+BeatRootVampPlugin::makeFeatures(const EventList &el, const EventList &unfilled)
+{
     Feature f;
     f.hasTimestamp = true;
     f.hasDuration = false;
@@ -332,6 +588,7 @@ BeatRootVampPlugin::getRemainingFeatures()
 
 
 static Vamp::PluginAdapter<BeatRootVampPlugin> brAdapter;
+static Vamp::PluginAdapter<BeatRootTimeDomainVampPlugin> brtdAdapter;
 
 const VampPluginDescriptor *vampGetPluginDescriptor(unsigned int version,
                                                     unsigned int index)
@@ -340,6 +597,7 @@ const VampPluginDescriptor *vampGetPluginDescriptor(unsigned int version,
 
     switch (index) {
     case  0: return brAdapter.getDescriptor();
+    case  1: return brtdAdapter.getDescriptor();
     default: return 0;
     }
 }
@@ -17,17 +17,20 @@
 #define _BEATROOT_VAMP_PLUGIN_H_
 
 #include "Agent.h"
+#include "Event.h"
+#include "Induction.h"
 
 #include <vamp-sdk/Plugin.h>
 
 using std::string;
 
 class BeatRootProcessor;
+class Reframer;
 
 class BeatRootVampPlugin : public Vamp::Plugin
 {
 public:
-    BeatRootVampPlugin(float inputSampleRate);
+    BeatRootVampPlugin(float inputSampleRate, bool timeDomain = false);
     virtual ~BeatRootVampPlugin();
 
     string getIdentifier() const;
@@ -62,12 +65,30 @@ public:
     FeatureSet getRemainingFeatures();
 
 protected:
+    FeatureSet makeFeatures(const EventList &beats, const EventList &unfilled);
+    void addTempoFeatures(FeatureSet &fs,
+                          const vector<TempoHypothesis> &hypotheses);
+    void addStatsFeature(FeatureSet &fs);
+
+    bool m_timeDomain;
     BeatRootProcessor *m_processor;
+    Reframer *m_reframer;
     AgentParameters m_parameters;
+    bool m_causal;
+    double m_lookahead;
+    bool m_tempoOnly;
+    double m_tempoDuration;
     Vamp::RealTime m_origin;
     bool m_firstFrame;
 };
 
-
+/** The BeatRoot plugin with time-domain input, which it transforms
+ *  itself, rather than relying on the host to do so. */
+class BeatRootTimeDomainVampPlugin : public BeatRootVampPlugin
+{
+public:
+    BeatRootTimeDomainVampPlugin(float inputSampleRate) :
+        BeatRootVampPlugin(inputSampleRate, true) { }
+};
 
 #endif
@@ -15,42 +15,43 @@
 
 #include "BeatTracker.h"
 
-EventList BeatTracker::beatTrack(AgentParameters params,
-                                 EventList events, EventList beats,
+EventList BeatTracker::beatTrack(TrackerContext &context,
+                                 const EventList &events,
+                                 const EventList &beats,
                                  EventList *unfilledReturn)
 {
-    AgentList agents;
+    // All agents created during this run, and their beat histories,
+    // are allocated in the context and released together at the end
+    context.reset();
+    AgentList agents(context);
     int count = 0;
     double beatTime = -1;
     if (!beats.empty()) {
 	count = beats.size() - 1;
-	EventList::iterator itr = beats.end();
-	--itr;
-	beatTime = itr->time;
+	beatTime = beats.back().time;
     }
     if (count > 0) { // tempo given by mean of initial beats
 	double ioi = (beatTime - beats.begin()->time) / count;
-	agents.push_back(new Agent(params, ioi));
+	agents.push_back(Agent::create(context, ioi));
     } else // tempo not given; use tempo induction
-	agents = Induction::beatInduction(params, events);
+	agents = Induction::beatInduction(context, events);
     if (!beats.empty())
 	for (AgentList::iterator itr = agents.begin(); itr != agents.end();
 	     ++itr) {
 	    (*itr)->beatTime = beatTime;
 	    (*itr)->beatCount = count;
-	    (*itr)->events = beats;
+	    (*itr)->events.assign(beats);
 	}
-    agents.beatTrack(events, params, -1);
+    agents.beatTrack(events, -1);
     Agent *best = agents.bestAgent();
     EventList results;
     if (best) {
-        if (unfilledReturn) *unfilledReturn = best->events;
-	best->fillBeats(beatTime);
-	results = best->events;
-    }
-    for (AgentList::iterator ai = agents.begin(); ai != agents.end(); ++ai) {
-	delete *ai;
+        // Only the winning agent's beats are ever needed as a list
+        results = best->getEvents();
+        if (unfilledReturn) *unfilledReturn = results;
+	best->fillBeats(results, beatTime);
     }
+    context.arena.reset();
     return results;
 } // beatTrack()/1
 	
@@ -20,6 +20,7 @@
 #include "Agent.h"
 #include "AgentList.h"
 #include "Induction.h"
+#include "TrackerContext.h"
 
 using std::vector;
 
@@ -39,7 +40,7 @@ public:
     /** Constructor:
      *  @param b The list of beats
      */
-    BeatTracker(EventList b) {
+    BeatTracker(const EventList &b) {
 	beats = b;
     } // BeatTracker constructor
 
@@ -53,26 +54,64 @@ public:
     } // newBeat()
 
     /** Perform beat tracking.
+     *  @param context The tracker, which supplies the parameters and
+     *     holds the state of the run
      *  @param events The onsets or peaks in a feature list
      *  @param unfilledReturn Pointer to list in which to return 
      *     un-interpolated beats, or NULL
      *  @return The list of beats, or an empty list if beat tracking fails
      */
-    static EventList beatTrack(AgentParameters params, EventList events,
+    static EventList beatTrack(TrackerContext &context,
+                               const EventList &events,
                                EventList *unfilledReturn) {
-	return beatTrack(params, events, EventList(), unfilledReturn);
+	return beatTrack(context, events, EventList(), unfilledReturn);
     }
 	
     /** Perform beat tracking.
+     *  @param context The tracker, which supplies the parameters and
+     *     holds the state of the run
      *  @param events The onsets or peaks in a feature list
      *  @param beats The initial beats which are given, if any
      *  @param unfilledReturn Pointer to list in which to return
      *     un-interpolated beats, or NULL
+     *  @return The list of beats, or an empty list if beat tracking
+     *     fails.  If the context's deadline passes during tracking,
+     *     these are the beats of the best Agent so far, and
+     *     context.partial is set.
+     */
+    static EventList beatTrack(TrackerContext &context,
+                               const EventList &events,
+                               const EventList &beats,
+                               EventList *unfilledReturn);
+
+    /** Perform beat tracking in a tracker of its own, with the
+     *  default induction parameters.
+     *  @param events The onsets or peaks in a feature list
+     *  @param unfilledReturn Pointer to list in which to return 
+     *     un-interpolated beats, or NULL
      *  @return The list of beats, or an empty list if beat tracking fails
      */
     static EventList beatTrack(AgentParameters params,
-                               EventList events, EventList beats,
-                               EventList *unfilledReturn);
+                               const EventList &events,
+                               EventList *unfilledReturn) {
+	return beatTrack(params, events, EventList(), unfilledReturn);
+    }
+	
+    /** Perform beat tracking in a tracker of its own, with the
+     *  default induction parameters.
+     *  @param events The onsets or peaks in a feature list
+     *  @param beats The initial beats which are given, if any
+     *  @param unfilledReturn Pointer to list in which to return
+     *     un-interpolated beats, or NULL
+     *  @return The list of beats, or an empty list if beat tracking fails
+     */
+    static EventList beatTrack(AgentParameters params,
+                               const EventList &events,
+                               const EventList &beats,
+                               EventList *unfilledReturn) {
+        TrackerContext context(params);
+        return beatTrack(context, events, beats, unfilledReturn);
+    }
 	
 	
     // Various get and set methods
@@ -90,7 +129,7 @@ public:
     /** Sets the onset times as a list of Events, for use by the beat tracking methods. 
      *  @param on The times of onsets in seconds
      */
-    void setOnsetList(EventList on) {
+    void setOnsetList(const EventList &on) {
 	onsetList = on;
     } // setOnsetList()
 
@@ -104,7 +143,7 @@ public:
     /** Sets the list of beats.
      * @param b The list of beats
      */
-    void setBeats(EventList b) {
+    void setBeats(const EventList &b) {
 	beats = b;
     } // setBeats()
 
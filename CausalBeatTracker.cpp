@@ -0,0 +1,171 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+#include "CausalBeatTracker.h"
+#include "Induction.h"
+
+#include <cmath>
+#include <utility>
+
+const double CausalBeatTracker::DEFAULT_LOOKAHEAD = 0.1;
+const double CausalBeatTracker::INDUCTION_TIME = 5.0;
+
+CausalBeatTracker::CausalBeatTracker(TrackerContext &c, double l) :
+    context(c),
+    lookahead(l),
+    agents(c),
+    tracking(false),
+    nextInduction(INDUCTION_TIME),
+    lastBeat(-HUGE_VAL),
+    committed(-HUGE_VAL)
+{
+} // constructor
+
+CausalBeatTracker::~CausalBeatTracker()
+{
+    if (tracking) agents.finishTracking();
+} // destructor
+
+void CausalBeatTracker::reset()
+{
+    if (tracking) agents.finishTracking();
+    agents = AgentList(context);
+    tracking = false;
+    recent.clear();
+    tempi.clear();
+    nextInduction = INDUCTION_TIME;
+    lastBeat = -HUGE_VAL;
+    committed = -HUGE_VAL;
+    context.reset();
+} // reset()
+
+void CausalBeatTracker::addOnset(const Event &e)
+{
+    if (tracking && agents.empty()) {
+        // All the agents have expired: start again
+#ifdef DEBUG_BEATROOT
+        std::cerr << "CausalBeatTracker: no agents left at " << e.time
+                  << ", restarting tempo induction" << std::endl;
+#endif
+        agents.finishTracking();
+        tracking = false;
+        nextInduction = e.time + INDUCTION_TIME;
+    }
+    if (tracking)
+        agents.trackEvent(e);
+    recent.push_back(e);
+    if (e.time >= nextInduction)
+        induce(e.time);
+    EventList::iterator keep = recent.begin();
+    while (keep->time < e.time - INDUCTION_TIME)
+        ++keep;
+    recent.erase(recent.begin(), keep);
+} // addOnset()
+
+void CausalBeatTracker::induce(double time)
+{
+    vector<TempoHypothesis> hypotheses;
+    AgentList found = Induction::beatInduction(context, recent, &hypotheses);
+    if (found.empty()) {
+        // Until tracking has started, try again with the next onset
+        if (tracking) nextInduction = time + INDUCTION_TIME;
+        return;
+    }
+    tempi.swap(hypotheses);
+    nextInduction = time + INDUCTION_TIME;
+    // The new agents track the recent onsets, with an agent for each
+    // phase in which they occur, as at the start of batch tracking
+    found.startTracking(time);
+    for (EventList::const_iterator i = recent.begin(); i != recent.end(); ++i) {
+        found.trackEvent(*i);
+    }
+    if (!tracking) {
+        // The new agents, and the tracking resources that
+        // startTracking() gave them, pass to agents.  found is left
+        // with the previous list, which is empty and not tracking,
+        // so nothing is owned by both.
+        std::swap(agents, found);
+        tracking = true;
+    } else {
+        found.finishTracking();
+        agents.adopt(found, time);
+    }
+} // induce()
+
+void CausalBeatTracker::getBeats(double now, EventList &beats,
+                                 EventList *unfilled)
+{
+    commit(now - lookahead, beats, unfilled);
+} // getBeats()
+
+void CausalBeatTracker::finish(double end, EventList &beats,
+                               EventList *unfilled)
+{
+    if (!tracking && !recent.empty())
+        induce(recent.back().time);
+    commit(end, beats, unfilled);
+} // finish()
+
+void CausalBeatTracker::commit(double limit, EventList &beats,
+                               EventList *unfilled)
+{
+    if (!tracking || limit <= committed)
+        return;
+    Agent *best = agents.bestAgent();
+    if (best) {
+        double ibi = best->beatInterval;
+        // The agent's tracked beats which have not been reported,
+        // except any within half a beat of the last one reported
+        // (which may have been a prediction, or come from another
+        // agent)
+        EventList tracked = best->events.toList(lastBeat + ibi / 2);
+        EventList::iterator i = tracked.begin();
+        for ( ; i != tracked.end() && i->time <= limit; ++i) {
+            if (i->time <= committed)
+                continue;
+            emit(i->time, ibi, beats);
+            if (unfilled) unfilled->push_back(*i);
+        }
+        // Then its predictions, beyond its last tracked beat
+        if (i == tracked.end()) {
+            int k = 1;
+            double from = lastBeat + ibi / 2;
+            if (from < committed) from = committed;
+            if (from > best->beatTime)
+                k = (int)floor((from - best->beatTime) / ibi) + 1;
+            for (double t = best->beatTime + k * ibi; t <= limit;
+                 t = best->beatTime + ++k * ibi) {
+                emit(t, ibi, beats);
+            }
+        }
+    }
+    committed = limit;
+} // commit()
+
+void CausalBeatTracker::emit(double time, double ibi, EventList &beats)
+{
+    // Interpolate missing beats, as in Agent::fillBeats(), where
+    // they are not too late to report
+    if (lastBeat > -HUGE_VAL) {
+        double n = nearbyint((time - lastBeat) / ibi - 0.01);   // prefer slow
+        double interval = (time - lastBeat) / n;
+        for (double t = lastBeat + interval; n > 1.5; --n, t += interval) {
+            if (t > committed) beats.push_back(Event(t, 0, 0));
+        }
+    }
+    beats.push_back(Event(time, 0, 0));
+    lastBeat = time;
+} // emit()
@@ -0,0 +1,136 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+#ifndef _CAUSAL_BEAT_TRACKER_H_
+#define _CAUSAL_BEAT_TRACKER_H_
+
+#include "AgentList.h"
+#include "Event.h"
+#include "Induction.h"
+#include "TrackerContext.h"
+
+/** Beat tracker for real-time use, which is given the onsets one at
+ *  a time as they are detected and reports each beat within a fixed
+ *  time (the lookahead) of its occurrence.
+ *
+ *  Tempo induction is performed on the onsets of the first
+ *  INDUCTION_TIME seconds, after which the Agents track each onset as
+ *  it arrives.  Induction is repeated every INDUCTION_TIME seconds on
+ *  the most recent onsets, and Agents for the tempo hypotheses found
+ *  join the others, so that changes of tempo can be followed.  Beats
+ *  are taken from whichever Agent currently has the best score
+ *  (decayed by default, see AgentParameters::decayFactor): its
+ *  tracked beats, with missing ones interpolated, and beyond its
+ *  last tracked beat, its predictions.  A beat once reported is never
+ *  withdrawn, and a beat which is found too late to be reported in
+ *  time (for example, when another Agent becomes the best) is
+ *  skipped.
+ */
+class CausalBeatTracker
+{
+public:
+    /** The default lookahead, in seconds */
+    static const double DEFAULT_LOOKAHEAD;
+
+    /** The length of input, in seconds, used for tempo induction */
+    static const double INDUCTION_TIME;
+
+    /** Constructor
+     *  @param context The tracker, which supplies the parameters
+     *  @param lookahead The time in seconds by which reported beats
+     *     lag the input, see getBeats()
+     */
+    CausalBeatTracker(TrackerContext &context, double lookahead);
+
+    ~CausalBeatTracker();
+
+    void setLookahead(double l) { lookahead = l; }
+    double getLookahead() const { return lookahead; }
+
+    /** Discards all onsets and Agents, ready for a new piece. */
+    void reset();
+
+    /** Adds an onset.  Onsets must be given in time order.
+     */
+    void addOnset(const Event &e);
+
+    /** Reports the beats up to lookahead seconds before the given
+     *  time which have not been reported before.  All onsets up to
+     *  the time must have been added.  No beats are reported until
+     *  tempo induction has been performed, when those found up to
+     *  then are all reported.
+     *  @param now The time of the end of the input so far
+     *  @param beats List to which the beats are appended
+     *  @param unfilled List to which the beats that were tracked
+     *     (rather than interpolated or predicted) are appended, or NULL
+     */
+    void getBeats(double now, EventList &beats, EventList *unfilled);
+
+    /** Reports all the remaining beats up to the end of the input.
+     *  @param end The time of the end of the input
+     *  @param beats List to which the beats are appended
+     *  @param unfilled List to which the beats that were tracked
+     *     are appended, or NULL
+     */
+    void finish(double end, EventList &beats, EventList *unfilled);
+
+    /** @return The tempo hypotheses of the latest tempo induction
+     *  which found any, best first (see Induction::tempoHypotheses()),
+     *  or none if there has been none since reset() */
+    const vector<TempoHypothesis> &getTempoHypotheses() const {
+        return tempi;
+    }
+
+protected:
+    TrackerContext &context;
+    double lookahead;
+
+    /** The Agents, once tempo induction has been performed */
+    AgentList agents;
+    bool tracking;
+
+    /** The onsets of the last INDUCTION_TIME seconds */
+    EventList recent;
+
+    /** The tempo hypotheses of the latest successful induction */
+    vector<TempoHypothesis> tempi;
+
+    /** The time of the first onset at which tempo induction is next
+     *  performed */
+    double nextInduction;
+
+    /** The time of the most recently reported beat */
+    double lastBeat;
+
+    /** The time up to which beats have been reported */
+    double committed;
+
+    /** Performs tempo induction on the recent onsets, and adds Agents
+     *  for any tempo hypotheses found, which have tracked the recent
+     *  onsets.
+     *  @param time The time of the latest onset */
+    void induce(double time);
+
+    /** Reports the beats up to the given time. */
+    void commit(double limit, EventList &beats, EventList *unfilled);
+
+    /** Reports a beat, and any that are missing between it and the
+     *  last one reported, for the given beat period. */
+    void emit(double time, double ibi, EventList &beats);
+
+}; // class CausalBeatTracker
+
+#endif
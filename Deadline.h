@@ -0,0 +1,77 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+#ifndef _DEADLINE_H_
+#define _DEADLINE_H_
+
+#include <atomic>
+#include <chrono>
+
+/** The point at which beat tracking is to stop early, returning the
+ *  beats found so far: a time, or the setting of a cancellation flag
+ *  by another thread, or both (see TrackerContext::deadline).  It is
+ *  checked between onsets, so tracking stops within the time taken to
+ *  offer one onset to the Agents after the deadline.  The default
+ *  Deadline never passes.
+ */
+class Deadline
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /** No deadline */
+    Deadline() : timed(false), cancelFlag(0) { }
+
+    /** A deadline at the given time */
+    Deadline(Clock::time_point t) : timed(true), time(t), cancelFlag(0) { }
+
+    /** @return A deadline the given number of seconds from now, or
+     *  no deadline if that is beyond the range of the clock */
+    static Deadline after(double seconds) {
+        if (!(seconds < 1e9)) return Deadline();
+        return Deadline(Clock::now() +
+                        std::chrono::duration_cast<Clock::duration>
+                        (std::chrono::duration<double>(seconds)));
+    }
+
+    /** Also stops tracking as soon as the given flag is set, which
+     *  may be done from any thread.  The flag must remain in existence
+     *  until tracking is finished.
+     *  @param flag The flag, or NULL for none */
+    void setCancelFlag(const std::atomic<bool> *flag) {
+        cancelFlag = flag;
+    }
+
+    /** @return Whether there is a time or a cancellation flag at all */
+    bool isSet() const {
+        return timed || cancelFlag;
+    }
+
+    /** @return Whether tracking should stop now */
+    bool hasPassed() const {
+        if (cancelFlag && cancelFlag->load(std::memory_order_relaxed))
+            return true;
+        return timed && Clock::now() >= time;
+    }
+
+protected:
+    bool timed;
+    Clock::time_point time;
+    const std::atomic<bool> *cancelFlag;
+
+}; // class Deadline
+
+#endif
@@ -16,7 +16,7 @@
 #ifndef _EVENT_H_
 #define _EVENT_H_
 
-#include <list>
+#include <vector>
 
 struct Event {
     double time;
@@ -26,15 +26,19 @@ struct Event {
     Event() : time(0), beat(0), salience(0) { }
     Event(double t, double b, double s) : time(t), beat(b), salience(s) { }
 
-    bool operator==(const Event &e) {
+    bool operator==(const Event &e) const {
 	return (time == e.time && beat == e.beat && salience == e.salience);
     }
-    bool operator!=(const Event &e) {
+    bool operator!=(const Event &e) const {
 	return !operator==(e);
     }
 };
 
-typedef std::list<Event> EventList;
+/** A sequence of Events in time order.  Events are held contiguously,
+ *  24 bytes each, so that long lists of onsets are compact and quick to
+ *  scan; Events are only ever appended, except when beats are
+ *  interpolated by Agent::fillBeats(), which rebuilds the list. */
+typedef std::vector<Event> EventList;
 
 #endif
 
@@ -0,0 +1,49 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+#include "EventHistory.h"
+
+#include <algorithm>
+
+EventList EventHistory::toList() const
+{
+    EventList el(length);
+    size_t i = length;
+    for (const Node *n = head; n; n = n->prev) {
+        el[--i] = n->event;
+    }
+    return el;
+} // toList()
+
+EventList EventHistory::toList(double after) const
+{
+    EventList el;
+    for (const Node *n = head; n && n->event.time > after; n = n->prev) {
+        el.push_back(n->event);
+    }
+    std::reverse(el.begin(), el.end());
+    return el;
+} // toList()/1
+
+void EventHistory::release(Node *n, MemoryPool *pool)
+{
+    // Iterative rather than recursive, as histories can be long
+    while (n && --n->refCount == 0) {
+        Node *prev = n->prev;
+        if (pool) pool->deallocate(n);
+        else delete n;
+        n = prev;
+    }
+} // release()
@@ -0,0 +1,123 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+#ifndef _EVENT_HISTORY_H_
+#define _EVENT_HISTORY_H_
+
+#include "Event.h"
+#include "MemoryPool.h"
+
+#include <cstddef>
+#include <new>
+
+/** An append-only sequence of Events which shares its storage with
+ *  all copies made of it.  The Events are held in a reference-counted
+ *  singly-linked list running from the most recent Event back to the
+ *  first, so copying a history (e.g. when an Agent is cloned) and
+ *  appending to it are both constant-time, and Agents that forked
+ *  from one another share the nodes for the beats they have in
+ *  common.  The sequence is only converted to an EventList when it
+ *  is needed in full, see toList().
+ */
+class EventHistory
+{
+public:
+    /** Constructs an empty history.
+     *  @param p The pool from which nodes are allocated, or NULL to
+     *     use the system allocator
+     */
+    explicit EventHistory(MemoryPool *p = 0) : head(0), length(0), pool(p) { }
+
+    EventHistory(const EventHistory &h) :
+        head(h.head), length(h.length), pool(h.pool) {
+        acquire(head);
+    }
+
+    EventHistory &operator=(const EventHistory &h) {
+        acquire(h.head);
+        release(head, pool);
+        head = h.head;
+        length = h.length;
+        pool = h.pool;
+        return *this;
+    }
+
+    ~EventHistory() {
+        release(head, pool);
+    }
+
+    /** Replaces the contents of the history with the given Events. */
+    void assign(const EventList &el) {
+        release(head, pool);
+        head = 0;
+        length = 0;
+        for (EventList::const_iterator i = el.begin(); i != el.end(); ++i) {
+            push_back(*i);
+        }
+    }
+
+    bool empty() const { return head == 0; }
+    size_t size() const { return length; }
+
+    /** @return The most recently appended Event */
+    const Event &back() const { return head->event; }
+
+    /** Appends an Event.  Other histories sharing the earlier Events
+     *  are unaffected. */
+    void push_back(const Event &e) {
+        Node *n = pool ? new (pool->allocate()) Node : new Node;
+        n->event = e;
+        n->prev = head; // takes over our reference to head
+        n->refCount = 1;
+        head = n;
+        ++length;
+    }
+
+    /** @return A copy of the Events in the order in which they were
+     *  appended */
+    EventList toList() const;
+
+    /** @return A copy of the most recent Events, in the order in
+     *  which they were appended, back to the last one that is not
+     *  later than the given time.  The time taken depends only on
+     *  the number of Events returned. */
+    EventList toList(double after) const;
+
+    /** @return The size of the memory needed for each Event, for
+     *  constructing a MemoryPool */
+    static size_t getNodeSize() { return sizeof(Node); }
+
+protected:
+    struct Node {
+        Event event;
+        Node *prev;
+        int refCount;
+    };
+
+    Node *head;
+    size_t length;
+    MemoryPool *pool;
+
+    static void acquire(Node *n) {
+        if (n) ++n->refCount;
+    }
+
+    /** Drops a reference to n, freeing it and any of its
+     *  predecessors that are no longer referenced. */
+    static void release(Node *n, MemoryPool *pool);
+
+}; // class EventHistory
+
+#endif
@@ -14,49 +14,123 @@
 */
 
 #include "Induction.h"
+#include "TrackerContext.h"
 
-double Induction::clusterWidth = 0.025;
-double Induction::minIOI = 0.070;
-double Induction::maxIOI = 2.500;
-double Induction::minIBI = 0.3; 
-double Induction::maxIBI = 1.0;
-int Induction::topN = 10;
+#include <algorithm>
 
+const double InductionParameters::DEFAULT_CLUSTER_WIDTH = 0.025;
+const double InductionParameters::DEFAULT_MIN_IOI = 0.070;
+const double InductionParameters::DEFAULT_MAX_IOI = 2.500;
+const double InductionParameters::DEFAULT_MIN_IBI = 0.3; 
+const double InductionParameters::DEFAULT_MAX_IBI = 1.0;
+const int InductionParameters::DEFAULT_TOP_N = 10;
+const InductionParameters::Method InductionParameters::DEFAULT_METHOD =
+    InductionParameters::Incremental;
+const int Induction::HISTOGRAM_RESOLUTION = 5;
 
-AgentList Induction::beatInduction(AgentParameters params, EventList events) {
-    int i, j, b, bestCount;
-    bool submult;
-    int intervals = 0;			// number of interval clusters
-    vector<int> bestn;// count of high-scoring clusters
-    bestn.resize(topN);
+/** Orders tempo hypotheses by decreasing score */
+class HigherScore
+{
+public:
+    bool operator()(const TempoHypothesis &a, const TempoHypothesis &b) const {
+        return a.score > b.score;
+    }
+};
 
-    double ratio, err;
-    int degree;
-    int maxClusterCount = (int) ceil((maxIOI - minIOI) / clusterWidth);
+/** Orders the bins of an IOI histogram by decreasing count */
+class FullerBin
+{
+public:
+    FullerBin(const vector<int> &c) : count(c) { }
+    bool operator()(int a, int b) const {
+        return count[a] > count[b];
+    }
+protected:
+    const vector<int> &count;
+};
+
+
+AgentList Induction::beatInduction(TrackerContext &context,
+                                   const EventList &events,
+                                   vector<TempoHypothesis> *tempoReturn) {
+    BEATROOT_STATS(TrackingStats::Timer timer(context.stats.inductionTime));
+    const InductionParameters &params = context.inductionParameters;
     vector<double> clusterMean;
-    clusterMean.resize(maxClusterCount);
     vector<int> clusterSize;
-    clusterSize.resize(maxClusterCount);
-    vector<int> clusterScore;
-    clusterScore.resize(maxClusterCount);
-		
-    EventList::iterator ptr1, ptr2;
-    Event e1, e2;
-    ptr1 = events.begin();
-    while (ptr1 != events.end()) {
-        e1 = *ptr1;
-        ++ptr1;
-        ptr2 = events.begin();
-        e2 = *ptr2;
-        ++ptr2;
-        while (e2 != e1 && ptr2 != events.end()) {
-            e2 = *ptr2;
-            ++ptr2;
-        }
-        while (ptr2 != events.end()) {
-            e2 = *ptr2;
-            ++ptr2;
-            double ioi = e2.time - e1.time;
+    if (params.method == InductionParameters::Histogram)
+        histogramClusters(params, events, clusterMean, clusterSize);
+    else
+        incrementalClusters(params, events, clusterMean, clusterSize);
+    vector<TempoHypothesis> hypotheses =
+        rankClusters(params, clusterMean, clusterSize);
+    if (tempoReturn) *tempoReturn = distinctTempi(params, hypotheses);
+    AgentList a(context);
+    for (size_t i = 0; i < hypotheses.size(); i++)
+        a.push_back(Agent::create(context, hypotheses[i].beatInterval));
+    BEATROOT_STATS(context.stats.inducedAgents += a.size());
+#ifdef DEBUG_BEATROOT
+    std::cerr << "Induction complete, returning " << a.size() << " agent(s)" << std::endl;
+#endif
+    return a;
+} // beatInduction()
+
+vector<TempoHypothesis> Induction::tempoHypotheses(const InductionParameters &params,
+                                                   const EventList &events) {
+    vector<double> clusterMean;
+    vector<int> clusterSize;
+    if (params.method == InductionParameters::Histogram)
+        histogramClusters(params, events, clusterMean, clusterSize);
+    else
+        incrementalClusters(params, events, clusterMean, clusterSize);
+    return distinctTempi(params,
+                         rankClusters(params, clusterMean, clusterSize));
+} // tempoHypotheses()
+
+vector<TempoHypothesis> Induction::distinctTempi(const InductionParameters &params,
+                                                 vector<TempoHypothesis> hypotheses) {
+    std::stable_sort(hypotheses.begin(), hypotheses.end(), HigherScore());
+    // Clusters at multiples of the same beat period can give the
+    // same tempo, which is only reported once
+    vector<TempoHypothesis> distinct;
+    for (size_t i = 0; i < hypotheses.size(); i++) {
+        size_t j = 0;
+        while ((j < distinct.size()) &&
+               (fabs(distinct[j].beatInterval - hypotheses[i].beatInterval) >=
+                params.clusterWidth / 2))
+            j++;
+        if (j == distinct.size())
+            distinct.push_back(hypotheses[i]);
+    }
+    return distinct;
+} // distinctTempi()
+
+void Induction::incrementalClusters(const InductionParameters &params,
+                                    const EventList &events,
+                                    vector<double> &clusterMean,
+                                    vector<int> &clusterSize) {
+    const double clusterWidth = params.clusterWidth;
+    const double minIOI = params.minIOI;
+    const double maxIOI = params.maxIOI;
+
+    int b;
+    int intervals = 0;			// number of interval clusters
+    int maxClusterCount = (int) ceil((maxIOI - minIOI) / clusterWidth);
+    clusterMean.assign(maxClusterCount, 0.0);
+    clusterSize.assign(maxClusterCount, 0);
+
+    // Each interval is measured forward from an Event to those that
+    // follow it within maxIOI.  If an earlier Event is identical to
+    // it, the intervals are measured from the earliest such Event
+    // instead, as they always have been.  Events are in time order,
+    // so any identical Events have the same time and are close by.
+    int n = events.size();
+    for (int e1 = 0; e1 < n; e1++) {
+        int first = e1;
+        for (int k = e1 - 1; k >= 0 && events[k].time == events[e1].time; k--)
+            if (events[k] == events[e1])
+                first = k;
+        for (int e2 = first + 1; e2 < n; e2++) {
+            double ioi = events[e2].time - events[e1].time;
             if (ioi < minIOI)		// skip short intervals
                 continue;
             if (ioi > maxIOI)		// ioi too long
@@ -87,6 +161,97 @@ AgentList Induction::beatInduction(AgentParameters params, EventList events) {
             }
         }
     }
+    clusterMean.resize(intervals);
+    clusterSize.resize(intervals);
+    mergeClusters(clusterWidth, clusterMean, clusterSize);
+} // incrementalClusters()
+
+void Induction::histogramClusters(const InductionParameters &params,
+                                  const EventList &events,
+                                  vector<double> &clusterMean,
+                                  vector<int> &clusterSize) {
+    const double clusterWidth = params.clusterWidth;
+    const double minIOI = params.minIOI;
+    const double maxIOI = params.maxIOI;
+
+    // The number and sum of the intervals falling in each bin
+    double binWidth = clusterWidth / HISTOGRAM_RESOLUTION;
+    int bins = (int) ceil((maxIOI - minIOI) / binWidth) + 1;
+    vector<int> binCount(bins, 0);
+    vector<double> binSum(bins, 0.0);
+
+    // The intervals from each Event are to those from low to high,
+    // which only move forward as the Event does
+    int n = events.size();
+    int low = 0, high = 0;
+    for (int e1 = 0; e1 < n; e1++) {
+        double t = events[e1].time;
+        if (low <= e1) low = e1 + 1;
+        while (low < n && events[low].time - t < minIOI)
+            low++;
+        if (high < low) high = low;
+        while (high < n && events[high].time - t <= maxIOI)
+            high++;
+        for (int e2 = low; e2 < high; e2++) {
+            double ioi = events[e2].time - t;
+            int bin = (int) ((ioi - minIOI) / binWidth);
+            binCount[bin]++;
+            binSum[bin] += ioi;
+        }
+    }
+
+    // Clusters are formed around the fullest bins in turn, each
+    // taking the bins not yet in a cluster whose means are within the
+    // cluster width of that of the bin around which it is formed
+    vector<int> order;
+    for (int bin = 0; bin < bins; bin++)
+        if (binCount[bin] > 0)
+            order.push_back(bin);
+    std::stable_sort(order.begin(), order.end(), FullerBin(binCount));
+    vector<int> cluster(bins, -1);
+    int clusters = 0;
+    for (size_t k = 0; k < order.size(); k++) {
+        int seed = order[k];
+        if (cluster[seed] >= 0)
+            continue;
+        double mean = binSum[seed] / binCount[seed];
+        int reach = HISTOGRAM_RESOLUTION + 1;
+        for (int bin = seed - reach; bin <= seed + reach; bin++)
+            if ((bin >= 0) && (bin < bins) && (binCount[bin] > 0) &&
+                (cluster[bin] < 0) &&
+                (fabs(binSum[bin] / binCount[bin] - mean) < clusterWidth))
+                cluster[bin] = clusters;
+        clusters++;
+    }
+    // The clusters are returned in order of their means
+    vector<double> sums(clusters, 0.0);
+    vector<int> counts(clusters, 0);
+    for (int bin = 0; bin < bins; bin++)
+        if (cluster[bin] >= 0) {
+            sums[cluster[bin]] += binSum[bin];
+            counts[cluster[bin]] += binCount[bin];
+        }
+    vector<std::pair<double, int> > found;
+    for (int c = 0; c < clusters; c++)
+        found.push_back(std::make_pair(sums[c] / counts[c], counts[c]));
+    std::sort(found.begin(), found.end());
+    clusterMean.clear();
+    clusterSize.clear();
+    for (int c = 0; c < clusters; c++) {
+        clusterMean.push_back(found[c].first);
+        clusterSize.push_back(found[c].second);
+    }
+
+    // Then neighbouring clusters whose means are within the cluster
+    // width are merged, as for the Incremental method
+    mergeClusters(clusterWidth, clusterMean, clusterSize);
+} // histogramClusters()
+
+void Induction::mergeClusters(double clusterWidth,
+                              vector<double> &clusterMean,
+                              vector<int> &clusterSize) {
+    int i, j, b;
+    int intervals = clusterMean.size();
     for (b = 0; b < intervals; b++)	// merge similar intervals
         // TODO: they are now in order, so don't need the 2nd loop
         // TODO: check BOTH sides before averaging or upper gps don't work
@@ -102,8 +267,32 @@ AgentList Induction::beatInduction(AgentParameters params, EventList events) {
                     clusterSize[j-1] = clusterSize[j];
                 }
             }
+    clusterMean.resize(intervals);
+    clusterSize.resize(intervals);
+} // mergeClusters()
+
+vector<TempoHypothesis> Induction::rankClusters(const InductionParameters &params,
+                                                const vector<double> &clusterMean,
+                                                const vector<int> &clusterSize) {
+    const double clusterWidth = params.clusterWidth;
+    const double minIBI = params.minIBI;
+    const double maxIBI = params.maxIBI;
+    const int topN = params.topN;
+
+    int i, j, b, bestCount;
+    bool submult;
+    int intervals = clusterMean.size();
+    vector<int> bestn;// count of high-scoring clusters
+    bestn.resize(topN);
+
+    double ratio, err;
+    int degree;
+    vector<int> clusterScore;
+    clusterScore.resize(intervals);
+		
+    vector<TempoHypothesis> hypotheses;
     if (intervals == 0)
-        return AgentList();
+        return hypotheses;
     for (b = 0; b < intervals; b++)
         clusterScore[b] = 10 * clusterSize[b];
     bestn[0] = 0;
@@ -143,7 +332,6 @@ AgentList Induction::beatInduction(AgentParameters params, EventList events) {
             }
         }
 
-    AgentList a;
     for (int index = 0; index < bestCount; index++) {
         b = bestn[index];
         // Adjust it, using the size of super- and sub-intervals
@@ -183,12 +371,12 @@ AgentList Induction::beatInduction(AgentParameters params, EventList events) {
         while (beat > maxIBI)		// Minimum speed
             beat /= 2.0;
         if (beat >= minIBI) {
-            a.push_back(new Agent(params, beat));
+            TempoHypothesis h;
+            h.beatInterval = beat;
+            h.score = clusterScore[b];
+            hypotheses.push_back(h);
         }
     }
-#ifdef DEBUG_BEATROOT
-    std::cerr << "Induction complete, returning " << a.size() << " agent(s)" << std::endl;
-#endif
-    return a;
-} // beatInduction()
+    return hypotheses;
+} // rankClusters()
 
@@ -28,29 +28,56 @@
 
 using std::vector;
 
-/** Performs tempo induction by finding clusters of similar
- *  inter-onset intervals (IOIs), ranking them according to the number
- *  of intervals and relationships between them, and returning a set
- *  of tempo hypotheses for initialising the beat tracking agents.
- */
-class Induction
+class TrackerContext;
+
+class InductionParameters
 {
 public:
+    static const double DEFAULT_CLUSTER_WIDTH;
+    static const double DEFAULT_MIN_IOI;
+    static const double DEFAULT_MAX_IOI;
+    static const double DEFAULT_MIN_IBI;
+    static const double DEFAULT_MAX_IBI;
+    static const int DEFAULT_TOP_N;
+
+    /** The ways in which the inter-onset intervals (IOIs) may be
+     *  clustered (see method) */
+    enum Method {
+        /** Each IOI in turn is added to the nearest cluster, as in
+         *  the original BeatRoot */
+        Incremental,
+        /** The IOIs are counted in a histogram, whose bins are then
+         *  grouped into clusters.  The time taken does not depend on
+         *  the number of clusters, and the tempo hypotheses are
+         *  close to those of Incremental, but not identical. */
+        Histogram
+    };
+    static const Method DEFAULT_METHOD;
+
+    InductionParameters() :
+        clusterWidth(DEFAULT_CLUSTER_WIDTH),
+        minIOI(DEFAULT_MIN_IOI),
+        maxIOI(DEFAULT_MAX_IOI),
+        minIBI(DEFAULT_MIN_IBI),
+        maxIBI(DEFAULT_MAX_IBI),
+        topN(DEFAULT_TOP_N),
+        method(DEFAULT_METHOD) { }
+
     /** The maximum difference in IOIs which are in the same cluster */ 
-    static double clusterWidth;
+    double clusterWidth;
     
     /** The minimum IOI for inclusion in a cluster */
-    static double minIOI;
+    double minIOI;
 	
     /** The maximum IOI for inclusion in a cluster */
-    static double maxIOI;
+    double maxIOI;
 	
     /** The minimum inter-beat interval (IBI), i.e. the maximum tempo
      *  hypothesis that can be returned.
      *  0.30 seconds == 200 BPM
      *  0.25 seconds == 240 BPM
      */
-    static double minIBI; 
+    double minIBI; 
 
     /** The maximum inter-beat interval (IBI), i.e. the minimum tempo
      *  hypothesis that can be returned.
@@ -58,19 +85,108 @@ public:
      *  0.75 seconds ==  80 BPM
      *  0.60 seconds == 100 BPM
      */
-    static double maxIBI;	//  60BPM	// was 0.75 =>  80
+    double maxIBI;	//  60BPM	// was 0.75 =>  80
 	
     /** The maximum number of tempo hypotheses to return */
-    static int topN;
-	
+    int topN;
+
+    /** The way in which IOIs are clustered */
+    Method method;
+};
+
+/** A tempo hypothesis found by tempo induction */
+struct TempoHypothesis
+{
+    /** The beat period in seconds */
+    double beatInterval;
+
+    /** The score of the cluster of inter-onset intervals from which
+     *  it was found: 10 for each interval in the cluster, plus more
+     *  for the intervals of clusters related to it by simple ratios */
+    int score;
+};
+
+/** Performs tempo induction by finding clusters of similar
+ *  inter-onset intervals (IOIs), ranking them according to the number
+ *  of intervals and relationships between them, and returning a set
+ *  of tempo hypotheses for initialising the beat tracking agents.
+ */
+class Induction
+{
+public:
     /** Performs tempo induction (see JNMR 2001 paper by Simon Dixon for details). 
-     *  @param events The onsets (or other events) from which the tempo is induced
+     *  @param context The tracker, which supplies the induction
+     *     parameters and in which the agents are created
+     *  @param events The onsets (or other events) from which the tempo
+     *     is induced, in time order.  The intervals between them are
+     *     found in time proportional to the number of events and the
+     *     number that fall within maxIOI of each.
+     *  @param tempoReturn If not NULL, returns the tempo hypotheses
+     *     from the same clusters, as tempoHypotheses() would
      *  @return A list of beat tracking agents, where each is initialised with one
      *          of the top tempo hypotheses but no beats
      */
-    static AgentList beatInduction(AgentParameters params, EventList events);
+    static AgentList beatInduction(TrackerContext &context,
+                                   const EventList &events,
+                                   vector<TempoHypothesis> *tempoReturn = 0);
+
+    /** Performs tempo induction alone, for an estimate of the tempo
+     *  without beat tracking.
+     *  @param params The induction parameters
+     *  @param events The onsets (or other events) from which the tempo
+     *     is induced, in time order
+     *  @return The tempo hypotheses (those with which beatInduction()
+     *     would initialise its agents), in decreasing order of score.
+     *     Where several are within half the cluster width of each
+     *     other, only the first is returned.
+     */
+    static vector<TempoHypothesis> tempoHypotheses(const InductionParameters &params,
+                                                   const EventList &events);
 
 protected:
+    /** The number of bins of the IOI histogram in the width of a
+     *  cluster (Histogram method) */
+    static const int HISTOGRAM_RESOLUTION;
+
+    /** Clusters the IOIs between the events by the Incremental
+     *  method.
+     *  @param clusterMean Returns the mean IOI of each cluster
+     *  @param clusterSize Returns the number of IOIs in each cluster
+     */
+    static void incrementalClusters(const InductionParameters &params,
+                                    const EventList &events,
+                                    vector<double> &clusterMean,
+                                    vector<int> &clusterSize);
+
+    /** Clusters the IOIs between the events by the Histogram method,
+     *  returning them as incrementalClusters() does. */
+    static void histogramClusters(const InductionParameters &params,
+                                  const EventList &events,
+                                  vector<double> &clusterMean,
+                                  vector<int> &clusterSize);
+
+    /** Merges those clusters whose means are within the cluster
+     *  width of each other. */
+    static void mergeClusters(double clusterWidth,
+                              vector<double> &clusterMean,
+                              vector<int> &clusterSize);
+
+    /** Scores the clusters according to their sizes and the
+     *  relationships between them, and finds the tempo of each of
+     *  the top ones.
+     *  @return The hypotheses, in order of the sizes of their
+     *     clusters, which is the order in which beatInduction()
+     *     creates their agents
+     */
+    static vector<TempoHypothesis> rankClusters(const InductionParameters &params,
+                                                const vector<double> &clusterMean,
+                                                const vector<int> &clusterSize);
+
+    /** @return The distinct tempo hypotheses among those ranked by
+     *     rankClusters(), as returned by tempoHypotheses() */
+    static vector<TempoHypothesis> distinctTempi(const InductionParameters &params,
+                                                 vector<TempoHypothesis> hypotheses);
+
     /** For variable cluster widths in newInduction().
      * @param low The lowest IOI allowed in the cluster
      * @return The highest IOI allowed in the cluster
@@ -0,0 +1,55 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+#include "MemoryPool.h"
+
+#include <new>
+
+// Elements are aligned suitably for any of the types we store
+static const size_t ALIGNMENT = 16;
+
+MemoryPool::MemoryPool(size_t size, size_t perBlock) :
+    elementSize((size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT),
+    elementsPerBlock(perBlock > 0 ? perBlock : 1),
+    next(0),
+    end(0),
+    freeList(0)
+{
+    if (elementSize < sizeof(FreeElement)) elementSize = ALIGNMENT;
+}
+
+MemoryPool::~MemoryPool()
+{
+    reset();
+}
+
+void MemoryPool::reset()
+{
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        ::operator delete(blocks[i]);
+    }
+    blocks.clear();
+    next = end = 0;
+    freeList = 0;
+} // reset()
+
+void MemoryPool::addBlock()
+{
+    size_t bytes = elementSize * elementsPerBlock;
+    char *block = static_cast<char *>(::operator new(bytes));
+    blocks.push_back(block);
+    next = block;
+    end = block + bytes;
+} // addBlock()
@@ -0,0 +1,84 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+#ifndef _MEMORY_POOL_H_
+#define _MEMORY_POOL_H_
+
+#include <vector>
+#include <cstddef>
+
+/** A pool of fixed-size memory elements, carved out of large blocks.
+ *  Freed elements are kept on a free list and reused, so once the
+ *  pool has grown to its working size, allocate() and deallocate()
+ *  never call into the system allocator.  All blocks are returned to
+ *  the system at once by reset() or on destruction; objects living in
+ *  the pool are not destroyed at that point.
+ */
+class MemoryPool
+{
+public:
+    /** @param elementSize The size of each element in bytes
+     *  @param elementsPerBlock The number of elements obtained from
+     *     the system allocator at a time
+     */
+    MemoryPool(size_t elementSize, size_t elementsPerBlock = 1024);
+    ~MemoryPool();
+
+    void *allocate() {
+        if (freeList) {
+            FreeElement *e = freeList;
+            freeList = e->next;
+            return e;
+        }
+        if (next == end) addBlock();
+        void *p = next;
+        next += elementSize;
+        return p;
+    }
+
+    void deallocate(void *p) {
+        FreeElement *e = static_cast<FreeElement *>(p);
+        e->next = freeList;
+        freeList = e;
+    }
+
+    /** Releases all memory held by the pool, invalidating every
+     *  element allocated from it. */
+    void reset();
+
+    /** @return The number of blocks obtained from the system allocator */
+    size_t getBlockCount() const { return blocks.size(); }
+
+protected:
+    struct FreeElement {
+        FreeElement *next;
+    };
+
+    size_t elementSize;
+    size_t elementsPerBlock;
+    std::vector<char *> blocks;
+    char *next;
+    char *end;
+    FreeElement *freeList;
+
+    void addBlock();
+
+private:
+    MemoryPool(const MemoryPool &);
+    MemoryPool &operator=(const MemoryPool &);
+
+}; // class MemoryPool
+
+#endif
@@ -0,0 +1,33 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+#include "OnsetFunction.h"
+
+const size_t OnsetFunction::CHUNK_SIZE = 4096;
+
+void OnsetFunction::clear()
+{
+    vector<vector<double> >().swap(chunks);
+    vector<vector<float> >().swap(compactChunks);
+    count = 0;
+} // clear()
+
+size_t OnsetFunction::getMemoryUsage() const
+{
+    return chunks.size() * CHUNK_SIZE * sizeof(double) +
+        compactChunks.size() * CHUNK_SIZE * sizeof(float) +
+        chunks.capacity() * sizeof(vector<double>) +
+        compactChunks.capacity() * sizeof(vector<float>);
+} // getMemoryUsage()
@@ -0,0 +1,93 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+#ifndef _ONSET_FUNCTION_H_
+#define _ONSET_FUNCTION_H_
+
+#include <cstddef>
+#include <vector>
+
+using std::vector;
+
+/** The values of an onset detection function, one per frame, for
+ *  input of any length.  The values are held in chunks of fixed size,
+ *  so that the function grows without reallocating and copying what
+ *  it already holds, and never occupies more than one part-filled
+ *  chunk beyond its length.
+ *
+ *  Values are stored as doubles, or in compact mode as floats, which
+ *  halves the memory needed at the cost of rounding the values (and
+ *  so, very occasionally, changing a decision made by the peak
+ *  picker).  At the usual 100 frames per second, an hour of input
+ *  takes 2.88MB, or 1.44MB in compact mode, plus the unused part of
+ *  the last chunk and the index of chunks (2.89MB and 1.44MB in all
+ *  for exactly an hour); getMemoryUsage() reports the actual figure.
+ */
+class OnsetFunction
+{
+public:
+    /** The number of values in each chunk */
+    static const size_t CHUNK_SIZE;
+
+    OnsetFunction() : compact(false), count(0) { }
+
+    /** Selects compact (float) or full (double) storage, discarding
+     *  all values. */
+    void setCompact(bool c) {
+        clear();
+        compact = c;
+    }
+
+    bool isCompact() const { return compact; }
+
+    /** Appends the value for the next frame. */
+    void push_back(double value) {
+        size_t offset = count % CHUNK_SIZE;
+        if (compact) {
+            if (offset == 0) compactChunks.push_back(vector<float>(CHUNK_SIZE));
+            compactChunks.back()[offset] = float(value);
+        } else {
+            if (offset == 0) chunks.push_back(vector<double>(CHUNK_SIZE));
+            chunks.back()[offset] = value;
+        }
+        ++count;
+    }
+
+    /** @return The value for the given frame */
+    double operator[](size_t index) const {
+        if (compact) {
+            return compactChunks[index / CHUNK_SIZE][index % CHUNK_SIZE];
+        }
+        return chunks[index / CHUNK_SIZE][index % CHUNK_SIZE];
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    /** Discards all values, releasing their memory. */
+    void clear();
+
+    /** @return The number of bytes of memory occupied by the values */
+    size_t getMemoryUsage() const;
+
+protected:
+    bool compact;
+    size_t count;
+    vector<vector<double> > chunks;
+    vector<vector<float> > compactChunks;
+
+}; // class OnsetFunction
+
+#endif
@@ -0,0 +1,119 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+#ifndef _PCM_FORMAT_H_
+#define _PCM_FORMAT_H_
+
+#include <cstring>
+
+/** The layout of interleaved, little-endian PCM audio in memory, as
+ *  found in WAV and raw audio files, and the conversion of its sample
+ *  frames to mono floating-point values.
+ */
+class PCMFormat
+{
+public:
+    enum Encoding {
+        PCM8,           ///< unsigned 8-bit integer
+        PCM16,          ///< signed 16-bit integer
+        PCM24,          ///< signed 24-bit integer
+        PCM32,          ///< signed 32-bit integer
+        Float32,        ///< IEEE single precision
+        Float64         ///< IEEE double precision
+    };
+
+    PCMFormat(Encoding e = PCM16, int c = 1) : encoding(e), channels(c) { }
+
+    Encoding encoding;
+    int channels;
+
+    /** @return The size of one sample in bytes */
+    int getSampleBytes() const {
+        switch (encoding) {
+        case PCM8: return 1;
+        case PCM16: return 2;
+        case PCM24: return 3;
+        case PCM32: return 4;
+        case Float32: return 4;
+        case Float64: return 8;
+        }
+        return 0;
+    }
+
+    /** @return The size of one frame (a sample for each channel) in bytes */
+    int getFrameBytes() const {
+        return getSampleBytes() * channels;
+    }
+
+    /** Converts n frames of audio to mono values in the range -1 to 1,
+     *  by averaging the channels. */
+    void toMono(const unsigned char *frames, int n, float *mono) const;
+
+    /** @return The sample at p, as a value in the range -1 to 1 */
+    static float convert(Encoding encoding, const unsigned char *p) {
+        switch (encoding) {
+        case PCM8:
+            return (int(p[0]) - 128) / 128.f;
+        case PCM16:
+            return (short)(p[0] | (p[1] << 8)) / 32768.f;
+        case PCM24:
+            return (int)((p[0] << 8) | (p[1] << 16) |
+                         ((unsigned int)p[2] << 24)) / 2147483648.f;
+        case PCM32:
+            return (int)(p[0] | (p[1] << 8) | (p[2] << 16) |
+                         ((unsigned int)p[3] << 24)) / 2147483648.f;
+        case Float32: {
+            unsigned int u = p[0] | (p[1] << 8) | (p[2] << 16) |
+                ((unsigned int)p[3] << 24);
+            float f;
+            memcpy(&f, &u, 4);
+            return f;
+        }
+        case Float64: {
+            unsigned long long u = 0;
+            for (int i = 7; i >= 0; --i) u = (u << 8) | p[i];
+            double d;
+            memcpy(&d, &u, 8);
+            return float(d);
+        }
+        }
+        return 0.f;
+    }
+
+    /** @return The mono value of the frame at p */
+    float frameToMono(const unsigned char *p) const {
+        if (channels == 1) return convert(encoding, p);
+        int bytes = getSampleBytes();
+        float sum = 0.f;
+        for (int c = 0; c < channels; ++c) {
+            sum += convert(encoding, p);
+            p += bytes;
+        }
+        return sum / channels;
+    }
+
+}; // class PCMFormat
+
+inline void PCMFormat::toMono(const unsigned char *frames, int n, float *mono) const
+{
+    int bytes = getFrameBytes();
+    for (int i = 0; i < n; ++i) {
+        mono[i] = frameToMono(frames);
+        frames += bytes;
+    }
+}
+
+#endif
@@ -0,0 +1,177 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+#include "PeakPicker.h"
+#include "Peaks.h"
+
+#include <cfloat>
+#include <cmath>
+
+PeakPicker::PeakPicker(int w, double t, double d, bool r) :
+    width(w),
+    threshold(t),
+    decayRate(d),
+    isRelative(r),
+    lag(w),
+    history(w)
+{
+    if (isRelative) {
+        if (Peaks::post * width > lag) lag = Peaks::post * width;
+        if (Peaks::pre * width > history) history = Peaks::pre * width;
+    }
+    unsigned size = 1;
+    while ((int)size < 2 * width + 2) size *= 2;
+    maxima.resize(size);
+    maxMask = size - 1;
+    reset();
+} // constructor
+
+void PeakPicker::reset()
+{
+    data.clear();
+    base = 0;
+    count = 0;
+    next = 0;
+    av = 0;
+    maxFront = 0;
+    maxBack = 0;
+    maxEnd = 0;
+    sum = 0;
+    absSum = 0;
+    sumStart = 0;
+    sumEnd = 0;
+    sumUpdates = 0;
+} // reset()
+
+void PeakPicker::push(double value, vector<int> &peaks)
+{
+    push(&value, 1, peaks);
+} // push()
+
+void PeakPicker::push(const double *values, int n, vector<int> &peaks)
+{
+    data.insert(data.end(), values, values + n);
+    count += n;
+    while (next + lag < count) {
+        decide(peaks);
+    }
+    // Discard the values which are no longer needed, once there are
+    // enough of them to make it worth moving the rest
+    int unused = next - history - 1 - base;
+    if (unused > 4096 && unused > (int)data.size() / 2) {
+        data.erase(data.begin(), data.begin() + unused);
+        base += unused;
+    }
+} // push()
+
+void PeakPicker::finish(vector<int> &peaks)
+{
+    while (next < count) {
+        decide(peaks);
+    }
+} // finish()
+
+void PeakPicker::decide(vector<int> &peaks)
+{
+    // As in Peaks::findPeaks(), with the windows clipped to the
+    // values received so far
+    int mid = next++;
+    double value = at(mid);
+    if (mid == 0) av = value;
+    av = decayRate * av + (1 - decayRate) * value;
+    if (av < value)
+        av = value;
+    // The value is a peak if it is the first occurrence of the
+    // maximum from mid - width to mid + width
+    int stop = mid + width + 1;
+    if (stop > count)
+        stop = count;
+    while (maxEnd < stop) {
+        double v = at(maxEnd);
+        while (maxBack != maxFront &&
+               at(maxima[(maxBack - 1) & maxMask]) < v)
+            --maxBack;
+        maxima[maxBack++ & maxMask] = maxEnd++;
+    }
+    while (maxima[maxFront & maxMask] < mid - width)
+        ++maxFront;
+    int maxp = maxima[maxFront & maxMask];
+    int iStart = 0, iStop = 0;
+    if (isRelative) {
+        // The running sums follow the window for every value, not
+        // just the candidate peaks, so that the values they drop
+        // are still available
+        iStart = mid - Peaks::pre * width;
+        if (iStart < 0)
+            iStart = 0;
+        iStop = mid + Peaks::post * width;
+        if (iStop > count)
+            iStop = count;
+        while (sumEnd < iStop) {
+            double v = at(sumEnd++);
+            sum += v;
+            absSum += fabs(v);
+            ++sumUpdates;
+        }
+        while (sumStart < iStart) {
+            double v = at(sumStart++);
+            sum -= v;
+            absSum -= fabs(v);
+            ++sumUpdates;
+        }
+    }
+    if (maxp != mid || value < av)
+        return;
+    if (isRelative) {
+        if (overThreshold(mid, iStart, iStop))
+            peaks.push_back(mid);
+    } else if (value > threshold) {
+        peaks.push_back(mid);
+    }
+} // decide()
+
+bool PeakPicker::overThreshold(int mid, int start, int stop)
+{
+    int n = stop - start;
+    if (sumUpdates > 2 * n + 16) {
+        // Recalculate from time to time to stop rounding errors
+        // accumulating; the cost is shared between the updates
+        sum = 0;
+        absSum = 0;
+        for (int i = start; i < stop; ++i) {
+            sum += at(i);
+            absSum += fabs(at(i));
+        }
+        sumUpdates = 0;
+    }
+    double value = at(mid);
+    double margin = value - (sum / n + threshold);
+    // Bound the difference between the running sum and the sum as
+    // Peaks::overThreshold() calculates it, each of which may differ
+    // from the exact sum by the rounding errors of its updates
+    double error = 2 * (sumUpdates + 2 * n + 4) * DBL_EPSILON * absSum
+        / n + 4 * DBL_EPSILON *
+        (fabs(sum / n) + fabs(threshold) + fabs(value));
+    if (margin > error)
+        return true;
+    if (!(margin >= -error))
+        return false;
+    // Too close to call: sum the window just as Peaks does
+    double exact = 0;
+    for (int i = start; i < stop; ++i)
+        exact += at(i);
+    return (value > exact / n + threshold);
+} // overThreshold()
@@ -0,0 +1,137 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+#ifndef _PEAK_PICKER_H_
+#define _PEAK_PICKER_H_
+
+#include <vector>
+
+using std::vector;
+
+/** Peak picker which is given its data incrementally, one value or
+ *  one chunk at a time, finding the same peaks as Peaks::findPeaks()
+ *  does for the whole array.  Each peak is reported as soon as the
+ *  values following it which affect the decision have arrived, and
+ *  only those values which may still affect a decision are kept.
+ *
+ *  The exponential-decay average, the local maximum test and the
+ *  relative threshold are evaluated in a single pass, in time
+ *  independent of the peak width: the local maximum is found with a
+ *  monotonic queue, and the mean for the relative threshold is kept
+ *  as a running sum.  Where the running sum's rounding error could
+ *  change the result of the threshold test, the window is summed
+ *  again in the same order as Peaks::overThreshold() does.
+ */
+class PeakPicker
+{
+public:
+    /** Constructor: the parameters are those of Peaks::findPeaks()
+     *  @param width minimum distance between peaks
+     *  @param threshold minimum value of peaks
+     *  @param decayRate how quickly previous peaks are forgotten
+     *  @param isRelative minimum value of peaks is relative to local average
+     */
+    PeakPicker(int width, double threshold, double decayRate, bool isRelative);
+
+    /** Discards all data, so that the next value has index 0. */
+    void reset();
+
+    /** Adds the next value of the data.
+     *  @param value The value, whose index is the number of values
+     *     added since the last reset()
+     *  @param peaks List to which the indexes of any peaks that can
+     *     now be determined are appended
+     */
+    void push(double value, vector<int> &peaks);
+
+    /** Adds the next n values of the data.
+     *  @param peaks List to which the indexes of any peaks that can
+     *     now be determined are appended
+     */
+    void push(const double *values, int n, vector<int> &peaks);
+
+    /** Signals the end of the data.
+     *  @param peaks List to which the indexes of the remaining peaks
+     *     are appended
+     */
+    void finish(vector<int> &peaks);
+
+    /** @return The number of values that must follow an index before
+     *  it can be determined whether it is a peak. */
+    int getLatency() const { return lag; }
+
+protected:
+    int width;
+    double threshold;
+    double decayRate;
+    bool isRelative;
+
+    /** The number of values needed after a candidate peak */
+    int lag;
+
+    /** The number of values needed before a candidate peak */
+    int history;
+
+    /** The values from index base onwards (of which those before
+     *  next - history - 1 are no longer needed) */
+    vector<double> data;
+    int base;
+
+    /** The number of values added */
+    int count;
+
+    /** The index of the next candidate peak to be decided */
+    int next;
+
+    /** The decaying average of the values up to next */
+    double av;
+
+    /** Indexes of the values up to maxEnd which may be the maximum
+     *  of a later window: their values are in non-increasing order,
+     *  so the first is the (earliest) maximum of the window.  The
+     *  queue is held in a ring buffer from maxFront to maxBack, whose
+     *  size (a power of two) exceeds the width of the window. */
+    vector<int> maxima;
+    unsigned maxMask;
+    unsigned maxFront;
+    unsigned maxBack;
+    int maxEnd;
+
+    /** The sum, and sum of absolute values, of the values from
+     *  sumStart to sumEnd, and the number of updates to the sums
+     *  since they were last calculated afresh. */
+    double sum;
+    double absSum;
+    int sumStart;
+    int sumEnd;
+    int sumUpdates;
+
+    double at(int index) const {
+        return data[index - base];
+    }
+
+    /** Decides whether the value at index next is a peak, given the
+     *  values up to count. */
+    void decide(vector<int> &peaks);
+
+    /** Decides whether the value at index mid exceeds the mean of
+     *  the values from start to stop, which are those of the running
+     *  sums, by more than the threshold. */
+    bool overThreshold(int mid, int start, int stop);
+
+}; // class PeakPicker
+
+#endif
@@ -14,9 +14,10 @@
 */
 
 #include "Peaks.h"
+#include "PeakPicker.h"
 
-int Peaks::pre = 3;
-int Peaks::post = 1;
+const int Peaks::pre = 3;
+const int Peaks::post = 1;
 
 
 int Peaks::findPeaks(const vector<double> &data, vector<int> peaks, int width) {
@@ -56,32 +57,10 @@ int Peaks::findPeaks(const vector<double> &data, vector<int> peaks, int width) {
 vector<int> Peaks::findPeaks(const vector<double> &data, int width,
                              double threshold, double decayRate, bool isRelative) {
     vector<int> peaks;
-    int maxp = 0;
-    int mid = 0;
-    if (data.empty()) return peaks;
-    int end = data.size();
-    double av = data[0];
-    while (mid < end) {
-        av = decayRate * av + (1 - decayRate) * data[mid];
-        if (av < data[mid])
-            av = data[mid];
-        int i = mid - width;
-        if (i < 0)
-            i = 0;
-        int stop = mid + width + 1;
-        if (stop > (int)data.size())
-            stop = data.size();
-        maxp = i;
-        for (i++; i < stop; i++)
-            if (data[i] > data[maxp])
-                maxp = i;
-        if (maxp == mid) {
-            if (overThreshold(data, maxp, width, threshold, isRelative,av)){
-                peaks.push_back(maxp);
-            }
-        }
-        mid++;
-    }
+    PeakPicker picker(width, threshold, decayRate, isRelative);
+    if (!data.empty())
+        picker.push(&data[0], data.size(), peaks);
+    picker.finish(peaks);
     return peaks;
 } // findPeaks()
 
@@ -23,11 +23,12 @@ using std::vector;
 
 class Peaks
 {
-protected:
-    static int pre;
-    static int post;
-	
 public:
+    /** The extent of the window for the relative threshold before
+     *  and after a peak, in multiples of the peak width */
+    static const int pre;
+    static const int post;
+	
     /** General peak picking method for finding n local maxima in an array
      *  @param data input data
      *  @param peaks list of peak indexes
@@ -0,0 +1,188 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+#include "Pipeline.h"
+#include "RingBuffer.h"
+
+#include <exception>
+#include <functional>
+#include <thread>
+
+const size_t Pipeline::AUDIO_QUEUE_SIZE = 65536;
+const size_t Pipeline::FLUX_QUEUE_SIZE = 4096;
+
+size_t Pipeline::PCMSource::read(float *mono, size_t n)
+{
+    if (n > frames - position) n = frames - position;
+    format.toMono(data + position * format.getFrameBytes(), int(n), mono);
+    position += n;
+    return n;
+} // PCMSource::read()
+
+Pipeline::Pipeline(BeatRootProcessor &p) :
+    processor(p)
+{
+}
+
+/** Reads the audio from the source into the queue.  An exception
+ *  thrown by the source is kept in error, for run() to rethrow, and
+ *  the queue is aborted, so that the later stages stop early. */
+static void readStage(Pipeline::Source &source, RingBuffer<float> &audio,
+                      std::exception_ptr &error)
+{
+    try {
+        float block[4096];
+        size_t n;
+        while ((n = source.read(block, 4096)) > 0) {
+            if (!audio.write(block, n)) break;
+        }
+    } catch (...) {
+        error = std::current_exception();
+        audio.abort();
+    }
+    audio.close();
+} // readStage()
+
+/** Calculates the spectral flux of each frame and passes it to the
+ *  last stage, adding the time taken to the frameTime of stats */
+class FluxWriter : public BeatRootProcessor::FrameSink
+{
+public:
+    FluxWriter(BeatRootProcessor &p, RingBuffer<double> &f,
+               TrackingStats &s) :
+        processor(p), flux(f), stats(s) { }
+    void frame(const float *samples) {
+        double f;
+        {
+            BEATROOT_STATS(TrackingStats::Timer timer(stats.frameTime));
+            f = processor.computeTimeDomainFlux(samples);
+        }
+        flux.write(&f, 1);
+    }
+protected:
+    BeatRootProcessor &processor;
+    RingBuffer<double> &flux;
+    TrackingStats &stats;
+};
+
+/** Divides the audio into frames and calculates the spectral flux of
+ *  each, with the framing of BeatRootProcessor::processSamples(). */
+static void fluxFrames(BeatRootProcessor &processor,
+                       RingBuffer<float> &audio, RingBuffer<double> &flux,
+                       TrackingStats &stats)
+{
+    FluxWriter writer(processor, flux, stats);
+    float block[4096];
+    size_t n;
+    while ((n = audio.read(block, 4096)) > 0) {
+        processor.frameSamples(block, int(n), writer);
+    }
+    processor.flushFrames(writer);
+} // fluxFrames()
+
+/** Runs fluxFrames().  An exception it throws is kept in error, for
+ *  run() to rethrow, and both queues are aborted, so that the read
+ *  stage is not left waiting for space and the last stage stops. */
+static void fluxStage(BeatRootProcessor &processor,
+                      RingBuffer<float> &audio, RingBuffer<double> &flux,
+                      TrackingStats &stats, std::exception_ptr &error)
+{
+    try {
+        fluxFrames(processor, audio, flux, stats);
+    } catch (...) {
+        error = std::current_exception();
+        audio.abort();
+        flux.abort();
+    }
+    flux.close();
+} // fluxStage()
+
+/** Stops the other stages of a pipeline and waits for them to finish,
+ *  on leaving run() by any route.  If the last stage has failed, the
+ *  others may be waiting on their queues, which are aborted. */
+class StageGuard
+{
+public:
+    StageGuard(RingBuffer<float> &a, RingBuffer<double> &f,
+               std::thread &r, std::thread &t) :
+        audio(a), flux(f), reader(r), transformer(t) { }
+    ~StageGuard() {
+        audio.abort();
+        flux.abort();
+        if (reader.joinable()) reader.join();
+        if (transformer.joinable()) transformer.join();
+    }
+protected:
+    RingBuffer<float> &audio;
+    RingBuffer<double> &flux;
+    std::thread &reader;
+    std::thread &transformer;
+};
+
+EventList Pipeline::run(Source &source, EventList *unfilledReturn)
+{
+    RingBuffer<float> audio(AUDIO_QUEUE_SIZE);
+    RingBuffer<double> flux(FLUX_QUEUE_SIZE);
+
+    // The stages time their parts of the work of processing a frame
+    // separately, and the times are added to the processor's once
+    // the threads have finished
+    TrackingStats fluxStats, frameStats;
+    std::exception_ptr readError, fluxError;
+
+    std::thread reader, transformer;
+    StageGuard guard(audio, flux, reader, transformer);
+    reader = std::thread(readStage, std::ref(source), std::ref(audio),
+                         std::ref(readError));
+    transformer = std::thread(fluxStage, std::ref(processor),
+                              std::ref(audio), std::ref(flux),
+                              std::ref(fluxStats), std::ref(fluxError));
+
+    EventList beats, unfilled;
+    double values[256];
+    size_t n;
+    while ((n = flux.read(values, 256)) > 0) {
+        for (size_t i = 0; i < n; ++i) {
+            BEATROOT_STATS(TrackingStats::Timer timer(frameStats.frameTime));
+            processor.addFlux(values[i]);
+            // Beats are taken after each frame, as a plugin host
+            // would, so that they do not depend on the timing of
+            // the other stages
+            if (processor.isCausal()) {
+                EventList u;
+                EventList b = processor.getNewBeats(&u);
+                beats.insert(beats.end(), b.begin(), b.end());
+                unfilled.insert(unfilled.end(), u.begin(), u.end());
+            }
+        }
+    }
+
+    reader.join();
+    transformer.join();
+    if (readError) std::rethrow_exception(readError);
+    if (fluxError) std::rethrow_exception(fluxError);
+    BEATROOT_STATS(processor.addStats(fluxStats));
+    BEATROOT_STATS(processor.addStats(frameStats));
+
+    EventList u;
+    EventList b = processor.beatTrack(&u);
+    beats.insert(beats.end(), b.begin(), b.end());
+    unfilled.insert(unfilled.end(), u.begin(), u.end());
+    if (unfilledReturn) {
+        unfilledReturn->swap(unfilled);
+    }
+    return beats;
+} // run()
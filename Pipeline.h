@@ -0,0 +1,97 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+#include "BeatRootProcessor.h"
+#include "PCMFormat.h"
+
+/** Runs a BeatRootProcessor over a stream of audio in three stages on
+ *  separate threads, connected by RingBuffers: the reading and
+ *  conversion of the audio, the calculation of the spectral flux of
+ *  each frame, and the detection of onsets and tracking of beats.  A
+ *  long stream is then processed in about the time taken by the
+ *  slowest stage, rather than the sum of all three.
+ *
+ *  In batch mode, onset detection needs the flux of the whole stream,
+ *  so that the last stage only collects the flux until the end of the
+ *  stream, and then tracks the beats.  In causal mode, beats are
+ *  tracked as the flux arrives.
+ */
+class Pipeline
+{
+public:
+    /** The audio input of a pipeline, read on a thread of its own */
+    class Source
+    {
+    public:
+        virtual ~Source() { }
+
+        /** Reads up to n frames of mono audio.
+         *  @return The number of frames read, which is zero only at
+         *     the end of the audio */
+        virtual size_t read(float *mono, size_t n) = 0;
+    };
+
+    /** A Source of PCM audio in memory, which is converted to mono
+     *  as it is read. */
+    class PCMSource : public Source
+    {
+    public:
+        PCMSource(const unsigned char *d, size_t f, const PCMFormat &fmt) :
+            data(d), frames(f), format(fmt), position(0) { }
+
+        size_t read(float *mono, size_t n);
+
+        /** @return The number of frames read so far */
+        size_t getPosition() const { return position; }
+
+    protected:
+        const unsigned char *data;
+        size_t frames;
+        PCMFormat format;
+        size_t position;
+    };
+
+    /** The capacity of the queues between the stages, in samples and
+     *  in frames */
+    static const size_t AUDIO_QUEUE_SIZE;
+    static const size_t FLUX_QUEUE_SIZE;
+
+    /** @param processor The processor, which should be newly created or
+     *     reset, and which is used by all three stages */
+    Pipeline(BeatRootProcessor &processor);
+
+    /** Processes all the audio from the source, framed as by
+     *  BeatRootProcessor::processSamples(), and tracks its beats.  The
+     *  last stage runs on the calling thread.  If the source or any
+     *  stage throws an exception, the other stages are stopped, and
+     *  the exception is rethrown here once all the threads have
+     *  finished.
+     *  @param unfilledReturn Pointer to list in which to return
+     *     un-interpolated beats, or NULL
+     *  @return The beats, as returned by BeatRootProcessor::beatTrack()
+     *     (together with those returned by getNewBeats(), in causal mode)
+     */
+    EventList run(Source &source, EventList *unfilledReturn);
+
+protected:
+    BeatRootProcessor &processor;
+
+}; // class Pipeline
+
+#endif
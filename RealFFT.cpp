@@ -0,0 +1,160 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+#include "RealFFT.h"
+
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+RealFFT::RealFFT(int sz) :
+    size(sz),
+    window(sz),
+    twiddleRe(sz/2 + 1),
+    twiddleIm(sz/2 + 1),
+    bitReverse(sz/2),
+    work(sz)
+{
+    for (int i = 0; i < size; ++i) {
+        window[i] = 0.5 - 0.5 * cos(2 * M_PI * i / size);
+    }
+    for (int k = 0; k <= size/2; ++k) {
+        twiddleRe[k] = cos(2 * M_PI * k / size);
+        twiddleIm[k] = -sin(2 * M_PI * k / size);
+    }
+    int half = size/2;
+    int bits = 0;
+    while ((1 << bits) < half) ++bits;
+    for (int i = 0; i < half; ++i) {
+        int r = 0;
+        for (int b = 0; b < bits; ++b) {
+            if (i & (1 << b)) r |= 1 << (bits - 1 - b);
+        }
+        bitReverse[i] = r;
+    }
+} // constructor
+
+void RealFFT::forward(const float *frame, float *spectrum)
+{
+    int half = size/2;
+    double *z = &work[0];
+
+    // Window and rotate the frame by half its length (as the host
+    // does, so that the phase is relative to the centre of the
+    // frame), taking sample pairs as complex values in bit-reversed
+    // order
+    for (int i = 0; i < half; ++i) {
+        int j = 2 * i, k = 2 * bitReverse[i];
+        z[k] = frame[j ^ half] * window[j ^ half];
+        z[k+1] = frame[(j+1) ^ half] * window[(j+1) ^ half];
+    }
+
+    transform(spectrum);
+} // forward()
+
+/** Loads a frame of PCM audio as forward(const float *, float *) does
+ *  one of floats.  The encoding is a template parameter, so that the
+ *  conversion of each sample is resolved at compile time. */
+template <PCMFormat::Encoding E>
+static void load(const unsigned char *frame, int channels,
+                 const double *window, const int *bitReverse,
+                 int size, double *z)
+{
+    int half = size/2;
+    int bytes = PCMFormat(E, channels).getSampleBytes();
+    int stride = bytes * channels;
+    for (int i = 0; i < half; ++i) {
+        int j = 2 * i, k = 2 * bitReverse[i];
+        for (int m = 0; m < 2; ++m) {
+            int source = (j + m) ^ half;
+            const unsigned char *p = frame + source * stride;
+            float value = PCMFormat::convert(E, p);
+            if (channels > 1) {
+                for (int c = 1; c < channels; ++c) {
+                    value += PCMFormat::convert(E, p + c * bytes);
+                }
+                value /= channels;
+            }
+            z[k+m] = value * window[source];
+        }
+    }
+}
+
+void RealFFT::forward(const unsigned char *frame, const PCMFormat &format,
+                      float *spectrum)
+{
+    int c = format.channels;
+    const double *w = &window[0];
+    const int *br = &bitReverse[0];
+    double *z = &work[0];
+    switch (format.encoding) {
+    case PCMFormat::PCM8: load<PCMFormat::PCM8>(frame, c, w, br, size, z); break;
+    case PCMFormat::PCM16: load<PCMFormat::PCM16>(frame, c, w, br, size, z); break;
+    case PCMFormat::PCM24: load<PCMFormat::PCM24>(frame, c, w, br, size, z); break;
+    case PCMFormat::PCM32: load<PCMFormat::PCM32>(frame, c, w, br, size, z); break;
+    case PCMFormat::Float32: load<PCMFormat::Float32>(frame, c, w, br, size, z); break;
+    case PCMFormat::Float64: load<PCMFormat::Float64>(frame, c, w, br, size, z); break;
+    }
+    transform(spectrum);
+} // forward()/PCM
+
+void RealFFT::transform(float *spectrum)
+{
+    int half = size/2;
+    double *z = &work[0];
+
+    // Complex FFT of size half, in place; the twiddle factor for
+    // step j of a butterfly span of len is that of k = j * size/len
+    for (int len = 2; len <= half; len <<= 1) {
+        int stride = size / len;
+        for (int start = 0; start < half; start += len) {
+            for (int j = 0; j < len/2; ++j) {
+                double wr = twiddleRe[j * stride];
+                double wi = twiddleIm[j * stride];
+                double *a = z + 2 * (start + j);
+                double *b = a + len;
+                double br = b[0] * wr - b[1] * wi;
+                double bi = b[0] * wi + b[1] * wr;
+                b[0] = a[0] - br;
+                b[1] = a[1] - bi;
+                a[0] += br;
+                a[1] += bi;
+            }
+        }
+    }
+
+    // Separate the spectra of the even and odd samples (E and O) and
+    // combine them: X[k] = E[k] + W^k O[k], and X[half-k] is found
+    // from the same values as conj(E[k] - W^k O[k])
+    spectrum[0] = float(z[0] + z[1]);
+    spectrum[1] = 0.f;
+    spectrum[size] = float(z[0] - z[1]);
+    spectrum[size+1] = 0.f;
+    for (int k = 1; k <= half/2; ++k) {
+        double zr = z[2*k], zi = z[2*k+1];
+        double cr = z[2*(half-k)], ci = -z[2*(half-k)+1];
+        double er = 0.5 * (zr + cr), ei = 0.5 * (zi + ci);
+        double or_ = 0.5 * (zi - ci), oi = -0.5 * (zr - cr);
+        double wr = twiddleRe[k], wi = twiddleIm[k];
+        double tr = or_ * wr - oi * wi, ti = or_ * wi + oi * wr;
+        spectrum[2*k] = float(er + tr);
+        spectrum[2*k+1] = float(ei + ti);
+        spectrum[2*(half-k)] = float(er - tr);
+        spectrum[2*(half-k)+1] = float(ti - ei);
+    }
+} // transform()
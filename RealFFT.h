@@ -0,0 +1,91 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+#ifndef _REAL_FFT_H_
+#define _REAL_FFT_H_
+
+#include "PCMFormat.h"
+
+#include <vector>
+
+using std::vector;
+
+/** Windowed Fourier transform of real audio frames, as performed by a
+ *  Vamp host for a plugin with frequency-domain input: a frame is
+ *  multiplied by a Hann window, rotated by half its length, and
+ *  transformed, giving the spectrum in the host's layout of
+ *  interleaved real and imaginary parts for bins 0 to size/2.
+ *
+ *  The transform is a radix-2 complex FFT of half the frame size,
+ *  over the even and odd samples taken as real and imaginary parts,
+ *  from which the spectrum of the real frame is then separated.  The
+ *  window, twiddle factors and bit-reversal permutation are computed
+ *  once by the constructor, and the frame is transformed in place in
+ *  a buffer also allocated by the constructor, so that forward()
+ *  allocates no memory.
+ */
+class RealFFT
+{
+public:
+    /** Constructor
+     *  @param size The frame size, which must be a power of 2 of at
+     *     least 4
+     */
+    RealFFT(int size);
+
+    int getSize() const { return size; }
+
+    /** Windows and transforms a frame.
+     *  @param frame The size samples of the frame
+     *  @param spectrum The size + 2 values of the spectrum, as real
+     *     and imaginary parts of bins 0 to size/2 in turn
+     */
+    void forward(const float *frame, float *spectrum);
+
+    /** Windows and transforms a frame of PCM audio, converting it to
+     *  mono as it is read.
+     *  @param frame The size sample frames of the audio
+     *  @param format The layout of the audio
+     *  @param spectrum The size + 2 values of the spectrum, as for
+     *     forward(const float *, float *)
+     */
+    void forward(const unsigned char *frame, const PCMFormat &format,
+                 float *spectrum);
+
+protected:
+    /** The frame size */
+    int size;
+
+    /** The Hann window */
+    vector<double> window;
+
+    /** cos and -sin of 2 pi k / size, for k from 0 to size/2 */
+    vector<double> twiddleRe;
+    vector<double> twiddleIm;
+
+    /** The bit-reversal permutation of size/2 complex values */
+    vector<int> bitReverse;
+
+    /** The complex FFT of the frame, as interleaved real and
+     *  imaginary parts */
+    vector<double> work;
+
+    /** Transforms the windowed frame loaded into work. */
+    void transform(float *spectrum);
+
+}; // class RealFFT
+
+#endif
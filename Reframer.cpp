@@ -0,0 +1,132 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+#include "Reframer.h"
+#include "BeatRootProcessor.h"
+
+#include <cmath>
+
+Reframer::Reframer(BeatRootProcessor *p, bool td, int step, int block) :
+    processor(p),
+    timeDomain(td),
+    stepSize(step),
+    blockSize(block),
+    fftSize(p->getFFTSize()),
+    hopSize(p->getHopSize()),
+    direct(step == p->getHopSize() && block == p->getFFTSize()),
+    interpolating(block <= p->getFFTSize())
+{
+    if (direct)
+        return;
+    if (timeDomain) {
+        if (stepSize > blockSize) silence.resize(stepSize - blockSize, 0.f);
+    } else {
+        int bins = fftSize/2 + 1;
+        int hostBins = blockSize/2 + 1;
+        double ratio = double(blockSize) / fftSize;
+        binStart.resize(bins);
+        if (interpolating) {
+            binWeight.resize(bins);
+        } else {
+            binEnd.resize(bins);
+        }
+        for (int i = 0; i < bins; i++) {
+            double centre = i * ratio;
+            if (interpolating) {
+                int start = (int)floor(centre);
+                if (start > hostBins - 2) start = hostBins - 2;
+                binStart[i] = start;
+                binWeight[i] = float(centre - start);
+            } else {
+                int start = (int)ceil(centre - ratio/2);
+                int end = (int)floor(centre + ratio/2);
+                binStart[i] = (start < 0) ? 0 : start;
+                binEnd[i] = (end > hostBins - 1) ? hostBins - 1 : end;
+            }
+        }
+        magnitude.resize(hostBins);
+        previous.resize(bins);
+        current.resize(bins);
+        frame.resize(bins * 2, 0.f);
+    }
+    reset();
+} // constructor
+
+void Reframer::reset() {
+    blockCount = 0;
+    frameCount = 0;
+} // reset()
+
+void Reframer::process(const float *block) {
+    if (direct) {
+        if (timeDomain) {
+            processor->processTimeDomainFrame(block);
+        } else {
+            processor->processFrame(&block);
+        }
+        return;
+    }
+    if (!timeDomain) {
+        processSpectrum(block);
+        ++blockCount;
+        return;
+    }
+    // Each block gives the stream its samples up to the start of the
+    // next, so that the stream ends where the host's last step does,
+    // as the frames passed on directly do: the rest of the last block
+    // is only the host's padding
+    if (stepSize > blockSize) {
+        processor->processSamples(block, blockSize);
+        processor->processSamples(&silence[0], stepSize - blockSize);
+    } else {
+        processor->processSamples(block, stepSize);
+    }
+    ++blockCount;
+} // process()
+
+void Reframer::processSpectrum(const float *block) {
+    int hostBins = blockSize/2 + 1;
+    for (int i = 0; i < hostBins; i++) {
+        float re = block[i*2];
+        float im = block[i*2+1];
+        magnitude[i] = sqrtf(re * re + im * im);
+    }
+    int bins = fftSize/2 + 1;
+    for (int i = 0; i < bins; i++) {
+        int start = binStart[i];
+        if (interpolating) {
+            current[i] = magnitude[start] +
+                (magnitude[start+1] - magnitude[start]) * binWeight[i];
+        } else {
+            float sum = 0;
+            for (int j = start; j <= binEnd[i]; j++) sum += magnitude[j];
+            current[i] = sum / (binEnd[i] - start + 1);
+        }
+    }
+    // The processor's frames which fall after the previous host frame
+    // and no later than this one are interpolated between the two
+    long long time = blockCount * stepSize;
+    while (frameCount * hopSize <= time) {
+        float weight = float(frameCount * hopSize - (time - stepSize)) /
+            stepSize;
+        for (int i = 0; i < bins; i++) {
+            frame[i*2] = previous[i] + (current[i] - previous[i]) * weight;
+        }
+        const float *f = &frame[0];
+        processor->processFrame(&f);
+        ++frameCount;
+    }
+    previous.swap(current);
+} // processSpectrum()
@@ -0,0 +1,114 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+#ifndef _REFRAMER_H_
+#define _REFRAMER_H_
+
+#include <vector>
+
+class BeatRootProcessor;
+
+/** Adapts the frames supplied by a host, of any block size and at any
+ *  step, to the frames of getFFTSize() samples at intervals of
+ *  getHopSize() samples which a BeatRootProcessor expects.  Frames of
+ *  the expected size and step are passed on unchanged.
+ *
+ *  Time-domain blocks are joined into a continuous stream, which is
+ *  divided into frames again by BeatRootProcessor::processSamples(),
+ *  so that the frames are exactly those the processor would have
+ *  taken itself.  Each block gives the stream its samples up to the
+ *  start of the next, so that the stream ends with the host's last
+ *  step, and the frames remaining are those which start before its
+ *  end, as when the frames are passed on unchanged.  (So for input
+ *  whose length is a multiple of both steps, the beats found at any
+ *  block and step are those at the preferred ones.)  If the step is
+ *  longer than the block, the samples between blocks are unknown,
+ *  and are taken to be silent.
+ *
+ *  Frequency-domain frames cannot be re-windowed, so their magnitude
+ *  spectra are converted instead: to the processor's frequency
+ *  resolution, by linear interpolation between bins where the host's
+ *  resolution is coarser, or by averaging the bins within each of the
+ *  processor's where it is finer; and to the processor's hop, by
+ *  linear interpolation between the host's frames.  The processor's
+ *  frames then fall at multiples of its hop from the first frame, as
+ *  they would at the preferred step, and the beat times need no
+ *  further correction.
+ */
+class Reframer
+{
+public:
+    /** @param processor The processor to which the frames are given
+     *  @param timeDomain Whether the host's frames are of time-domain
+     *     samples, rather than interleaved real and imaginary parts
+     *     of blockSize/2+1 frequency bins
+     *  @param stepSize The interval between the host's frames, in samples
+     *  @param blockSize The size of the host's frames, in samples
+     */
+    Reframer(BeatRootProcessor *processor, bool timeDomain,
+             int stepSize, int blockSize);
+
+    /** @return Whether the host's frames are passed on unchanged */
+    bool isDirect() const { return direct; }
+
+    /** Processes the next of the host's frames. */
+    void process(const float *block);
+
+    /** Prepares for a new input, as BeatRootProcessor::reset() does. */
+    void reset();
+
+protected:
+    void processSpectrum(const float *block);
+
+    BeatRootProcessor *processor;
+    bool timeDomain;
+    int stepSize;
+    int blockSize;
+    int fftSize;
+    int hopSize;
+    bool direct;
+
+    /** The number of the host's frames processed.  This and the
+     *  sample positions found from it are long long, since they pass
+     *  2^31 samples after 13.5 hours at 44.1kHz, where long may have
+     *  only 32 bits (as on Windows). */
+    long long blockCount;
+
+    /** Time domain: silence for filling gaps between blocks */
+    std::vector<float> silence;
+
+    /** Frequency domain: whether the processor's bins are found by
+     *  interpolation (or by averaging), and for each of them, the
+     *  first of the host's bins from which it is found, and either
+     *  the weight of the next one (interpolation) or the last one
+     *  (averaging) */
+    bool interpolating;
+    std::vector<int> binStart;
+    std::vector<float> binWeight;
+    std::vector<int> binEnd;
+
+    /** Frequency domain: the magnitude spectrum of the host's frame,
+     *  the converted spectra of the previous and current host frames,
+     *  the processor's frame interpolated between them, and the
+     *  number of processor frames given so far */
+    std::vector<float> magnitude;
+    std::vector<float> previous;
+    std::vector<float> current;
+    std::vector<float> frame;
+    long long frameCount;
+
+}; // class Reframer
+
+#endif
@@ -0,0 +1,150 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+#ifndef _RING_BUFFER_H_
+#define _RING_BUFFER_H_
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+/** A bounded queue of values passed from one producer thread to one
+ *  consumer thread, without locks.  The producer waits while the queue
+ *  is full, so that a fast producer is held back to the pace of its
+ *  consumer, and the consumer waits while it is empty.
+ *
+ *  Waiting threads spin briefly, then yield, then sleep for short
+ *  intervals, so that a stage which is waiting for a slower one uses
+ *  little processor time.
+ */
+template <typename T>
+class RingBuffer
+{
+public:
+    /** @param capacity The minimum number of values the queue can
+     *     hold; it is rounded up to a power of 2 */
+    RingBuffer(size_t capacity) :
+        head(0), tail(0), closed(false), aborted(false)
+    {
+        size_t n = 1;
+        while (n < capacity) n <<= 1;
+        buffer.resize(n);
+        mask = n - 1;
+    }
+
+    /** Producer: adds up to n values without waiting.
+     *  @return The number of values added */
+    size_t tryWrite(const T *values, size_t n) {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t space = buffer.size() - (h - tail.load(std::memory_order_acquire));
+        if (n > space) n = space;
+        for (size_t i = 0; i < n; ++i) buffer[(h + i) & mask] = values[i];
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    /** Producer: adds n values, waiting for space as necessary.
+     *  @return False if the queue has been aborted, in which case it
+     *     returns at once, and the values not yet added are discarded */
+    bool write(const T *values, size_t n) {
+        int waits = 0;
+        while (n > 0) {
+            if (aborted.load(std::memory_order_acquire)) return false;
+            size_t written = tryWrite(values, n);
+            if (written > 0) {
+                values += written;
+                n -= written;
+                waits = 0;
+            } else {
+                wait(waits);
+            }
+        }
+        return true;
+    }
+
+    /** Producer: marks the end of the values. */
+    void close() {
+        closed.store(true, std::memory_order_release);
+    }
+
+    /** Either side: ends the transfer early, when the other side can
+     *  no longer be relied on to finish it (as when it fails).  A
+     *  producer waiting for space and a consumer waiting for values
+     *  both return, and every later read returns nothing. */
+    void abort() {
+        aborted.store(true, std::memory_order_release);
+    }
+
+    /** Consumer: takes up to n values, waiting until at least one is
+     *  available or the producer has closed the queue.
+     *  @return The number of values taken, which is zero only at the
+     *     end of the values, or if the queue has been aborted */
+    size_t read(T *values, size_t n) {
+        int waits = 0;
+        while (true) {
+            if (aborted.load(std::memory_order_acquire)) return 0;
+            size_t t = tail.load(std::memory_order_relaxed);
+            size_t available = head.load(std::memory_order_acquire) - t;
+            if (available == 0) {
+                if (closed.load(std::memory_order_acquire)) {
+                    // Values written before the close are visible now
+                    available = head.load(std::memory_order_acquire) - t;
+                    if (available == 0) return 0;
+                } else {
+                    wait(waits);
+                    continue;
+                }
+            }
+            if (n > available) n = available;
+            for (size_t i = 0; i < n; ++i) values[i] = buffer[(t + i) & mask];
+            tail.store(t + n, std::memory_order_release);
+            return n;
+        }
+    }
+
+protected:
+    std::vector<T> buffer;
+    size_t mask;
+
+    // The counts of values written and read, on separate cache lines
+    // as each is updated by a different thread
+    char padding0[64];
+    std::atomic<size_t> head;
+    char padding1[64];
+    std::atomic<size_t> tail;
+    char padding2[64];
+    std::atomic<bool> closed;
+    std::atomic<bool> aborted;
+
+    static void wait(int &waits) {
+        if (waits < 64) {
+            ++waits;
+        } else if (waits < 256) {
+            ++waits;
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+private:
+    RingBuffer(const RingBuffer &);
+    RingBuffer &operator=(const RingBuffer &);
+
+}; // class RingBuffer
+
+#endif
@@ -0,0 +1,301 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+#include "SegmentedBeatTracker.h"
+#include "AgentList.h"
+#include "BeatTracker.h"
+#include "Induction.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <mutex>
+
+#ifdef DEBUG_BEATROOT
+#include <iostream>
+#endif
+
+const double SegmentedBeatTracker::DEFAULT_SEGMENT_LENGTH = 120.0;
+const double SegmentedBeatTracker::DEFAULT_OVERLAP = 20.0;
+
+/** Tracks the segments of a list, one per task.  The ThreadPool does
+ *  not handle exceptions, so the first thrown by any task is kept, to
+ *  be rethrown on the calling thread, and the tasks not yet started
+ *  are skipped. */
+class SegmentTask : public ThreadPool::Task
+{
+public:
+    SegmentTask(const TrackerContext &s, const EventList &e,
+                vector<SegmentedBeatTracker::Segment> &seg,
+                void (*t)(const TrackerContext &, const EventList &,
+                          SegmentedBeatTracker::Segment &)) :
+        settings(s), events(e), segments(seg), track(t), failed(false) { }
+
+    void run(int index) {
+        if (failed.load()) return;
+        try {
+            track(settings, events, segments[index]);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error) error = std::current_exception();
+            failed.store(true);
+        }
+    }
+
+    /** Rethrows the first exception thrown by a task, if any */
+    void rethrow() {
+        if (error) std::rethrow_exception(error);
+    }
+
+protected:
+    const TrackerContext &settings;
+    const EventList &events;
+    vector<SegmentedBeatTracker::Segment> &segments;
+    void (*track)(const TrackerContext &, const EventList &,
+                  SegmentedBeatTracker::Segment &);
+    std::mutex mutex;
+    std::exception_ptr error;
+    std::atomic<bool> failed;
+};
+
+/** Orders Events before the times that follow them, for finding the
+ *  Events of a segment by binary search of the sorted list */
+class EarlierThan
+{
+public:
+    bool operator()(const Event &e, double time) const {
+        return e.time < time;
+    }
+};
+
+void SegmentedBeatTracker::trackSegment(const TrackerContext &settings,
+                                        const EventList &events,
+                                        Segment &segment)
+{
+    // The events are in time order, so those of the segment are found
+    // in time logarithmic in their number, rather than by a scan
+    // from the start of the piece
+    EventList::const_iterator first =
+        std::lower_bound(events.begin(), events.end(), segment.start,
+                         EarlierThan());
+    EventList::const_iterator last =
+        std::lower_bound(first, events.end(), segment.end, EarlierThan());
+    EventList el(first, last);
+
+    // Each segment is tracked by a tracker of its own, on one thread
+    TrackerContext context(settings.agentParameters);
+    context.agentParameters.threadCount = 1;
+    context.inductionParameters = settings.inductionParameters;
+    context.useAverageSalience = settings.useAverageSalience;
+    context.deadline = settings.deadline;
+
+    AgentList agents = Induction::beatInduction(context, el);
+    // New phases are considered at the start of the segment, as they
+    // are at the start of the piece in a whole-piece run
+    agents.startTracking(segment.start + AgentList::DEFAULT_NEW_AGENT_TIME);
+    bool timed = context.deadline.isSet();
+    for (EventList::const_iterator ei = el.begin(); ei != el.end(); ++ei) {
+        if (timed && context.deadline.hasPassed()) {
+            segment.partial = true;
+            segment.cutoff = ei->time;
+            break;
+        }
+        agents.trackEvent(*ei);
+    }
+    agents.finishTracking();
+
+    Agent *best = agents.bestAgent();
+    if (best) {
+        EventList results = best->getEvents();
+        for (EventList::const_iterator i = results.begin(); i != results.end(); ++i) {
+            segment.unfilled.push_back(i->time);
+        }
+        best->fillBeats(results, -1.0);
+        for (EventList::const_iterator i = results.begin(); i != results.end(); ++i) {
+            segment.beats.push_back(i->time);
+        }
+    }
+    context.arena.reset();
+    BEATROOT_STATS(segment.stats = context.stats);
+} // trackSegment()
+
+/** @return The median interval between the beats from start to end,
+ *  or zero if there are fewer than two */
+static double medianInterval(const vector<double> &beats, double start, double end)
+{
+    vector<double> intervals;
+    for (size_t i = 1; i < beats.size(); ++i) {
+        if (beats[i-1] >= start && beats[i] <= end) {
+            intervals.push_back(beats[i] - beats[i-1]);
+        }
+    }
+    if (intervals.empty()) return 0;
+    std::nth_element(intervals.begin(), intervals.begin() + intervals.size()/2,
+                     intervals.end());
+    return intervals[intervals.size()/2];
+} // medianInterval()
+
+bool SegmentedBeatTracker::join(vector<double> &beats, vector<double> &unfilled,
+                                const Segment &next, double overlapEnd)
+{
+    if (next.beats.empty()) return false;
+    if (beats.empty()) {
+        beats = next.beats;
+        unfilled = next.unfilled;
+        return false;
+    }
+
+    // The later segment's first beats may be unsettled, as its Agents
+    // have only just started, so the second half of the overlap is
+    // preferred for the join
+    double windowStart = next.start + (overlapEnd - next.start) / 4;
+    double middle = (windowStart + overlapEnd) / 2;
+    double ibi = medianInterval(beats, next.start, overlapEnd);
+    if (ibi <= 0) ibi = medianInterval(next.beats, next.start, overlapEnd);
+    double tolerance = 0.1 * ibi;
+
+    // Find the pairs of consecutive beats on which both agree, and
+    // take the one nearest the middle of the window
+    size_t bestA = 0, bestB = 0;
+    double bestDistance = HUGE_VAL;
+    size_t j = 0;
+    for (size_t i = 0; i + 1 < beats.size() && ibi > 0; ++i) {
+        double a = beats[i];
+        if (a < windowStart) continue;
+        if (beats[i+1] > overlapEnd) break;
+        while (j < next.beats.size() && next.beats[j] < a - tolerance) ++j;
+        if (j + 1 >= next.beats.size()) break;
+        if (fabs(next.beats[j] - a) <= tolerance &&
+            fabs(next.beats[j+1] - beats[i+1]) <= tolerance &&
+            fabs(a - middle) < bestDistance) {
+            bestA = i;
+            bestB = j;
+            bestDistance = fabs(a - middle);
+        }
+    }
+
+    bool aligned = (bestDistance < HUGE_VAL);
+    double cut;
+    if (aligned) {
+        cut = next.beats[bestB + 1];
+        beats.resize(bestA + 1);
+        beats.insert(beats.end(), next.beats.begin() + bestB + 1, next.beats.end());
+    } else {
+        // Cut at the middle, dropping any beat of the later segment
+        // that is too close to the last of the earlier one, and
+        // interpolating any missing beats
+        cut = middle;
+        beats.erase(std::lower_bound(beats.begin(), beats.end(), cut), beats.end());
+        vector<double>::const_iterator ni =
+            std::lower_bound(next.beats.begin(), next.beats.end(), cut);
+        if (!beats.empty()) {
+            double last = beats.back();
+            double nextIBI = medianInterval(next.beats, cut, next.end);
+            if (nextIBI <= 0) nextIBI = ibi;
+            while (ni != next.beats.end() && *ni - last < nextIBI / 2) ++ni;
+            if (ni != next.beats.end() && nextIBI > 0) {
+                double gap = *ni - last;
+                int n = (int)lrint(gap / nextIBI);
+                for (int k = 1; k < n; ++k) beats.push_back(last + gap * k / n);
+            }
+            if (ni != next.beats.end()) cut = *ni;
+        }
+        beats.insert(beats.end(), ni, next.beats.end());
+    }
+    unfilled.erase(std::lower_bound(unfilled.begin(), unfilled.end(), cut),
+                   unfilled.end());
+    unfilled.insert(unfilled.end(),
+                    std::lower_bound(next.unfilled.begin(), next.unfilled.end(), cut),
+                    next.unfilled.end());
+#ifdef DEBUG_BEATROOT
+    std::cerr << "SegmentedBeatTracker: joined segment at " << next.start
+              << (aligned ? " at aligned beats" : " without alignment")
+              << std::endl;
+#endif
+    return aligned;
+} // join()
+
+EventList SegmentedBeatTracker::beatTrack(TrackerContext &settings,
+                                          const EventList &events,
+                                          double segmentLength, double overlap,
+                                          EventList *unfilledReturn)
+{
+    settings.partial = false;
+    if (events.empty()) return EventList();
+    if (overlap > segmentLength / 2) overlap = segmentLength / 2;
+    double step = segmentLength - overlap;
+    double end = events.back().time + 1;
+
+    // The last segment is extended to the end, rather than leaving a
+    // short one
+    int count = 1;
+    if (end > segmentLength && step > 0) {
+        count = (int)lrint((end - overlap) / step);
+        if (count < 1) count = 1;
+    }
+    vector<Segment> segments(count);
+    for (int i = 0; i < count; ++i) {
+        segments[i].start = i * step;
+        segments[i].end = (i + 1 == count) ? end : i * step + segmentLength;
+        segments[i].partial = false;
+        segments[i].cutoff = segments[i].end;
+    }
+
+    ThreadPool pool(std::min(settings.agentParameters.threadCount, count));
+    SegmentTask task(settings, events, segments, trackSegment);
+    pool.run(task, count);
+    task.rethrow();
+    BEATROOT_STATS(for (int i = 0; i < count; ++i)
+                       settings.stats.add(segments[i].stats));
+    // The beats of a partial result cover only the start of the
+    // input, up to the point at which the first segment stopped early
+    // was stopped.  Later segments are not joined, since there would
+    // be nothing but interpolation across the gap before them.
+    int joined = count;
+    for (int i = 0; i < count; ++i) {
+        if (segments[i].partial) {
+            settings.partial = true;
+            joined = i + 1;
+            break;
+        }
+    }
+
+    vector<double> beats = segments[0].beats, unfilled = segments[0].unfilled;
+    for (int i = 1; i < joined; ++i) {
+        join(beats, unfilled, segments[i], segments[i-1].end);
+    }
+    if (settings.partial) {
+        double cutoff = segments[joined - 1].cutoff;
+        beats.erase(std::lower_bound(beats.begin(), beats.end(), cutoff),
+                    beats.end());
+        unfilled.erase(std::lower_bound(unfilled.begin(), unfilled.end(), cutoff),
+                       unfilled.end());
+    }
+
+    EventList results;
+    for (size_t i = 0; i < beats.size(); ++i) {
+        results.push_back(BeatTracker::newBeat(beats[i], 0));
+    }
+    if (unfilledReturn) {
+        unfilledReturn->clear();
+        for (size_t i = 0; i < unfilled.size(); ++i) {
+            unfilledReturn->push_back(BeatTracker::newBeat(unfilled[i], 0));
+        }
+    }
+    return results;
+} // beatTrack()
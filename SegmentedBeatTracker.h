@@ -0,0 +1,112 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+#ifndef _SEGMENTED_BEAT_TRACKER_H_
+#define _SEGMENTED_BEAT_TRACKER_H_
+
+#include "Event.h"
+#include "TrackerContext.h"
+
+#include <vector>
+
+using std::vector;
+
+/** Beat tracker for very long recordings, which divides the onsets
+ *  into overlapping segments, tracks the beats of each segment
+ *  separately (with tempo induction of its own), and joins the beat
+ *  sequences of neighbouring segments within their overlap.
+ *
+ *  The segments are tracked in parallel, on as many threads as the
+ *  threadCount of the AgentParameters, and only the Agents of the
+ *  segments being tracked are in memory at any time.  Since each
+ *  segment starts afresh, a segmented track can follow large changes
+ *  of tempo that a single run of Agents cannot, but may not keep to
+ *  the same metrical level throughout.
+ *
+ *  Sequences are joined at a pair of consecutive beats that both
+ *  segments agree on, in phase and tempo, near the middle of the
+ *  overlap; the earlier segment's beats are taken up to the first of
+ *  the pair, and the later segment's beats from the second.  Where no
+ *  such pair exists, the sequences are cut at the middle of the
+ *  overlap, and any gap between them filled with interpolated beats.
+ */
+class SegmentedBeatTracker
+{
+public:
+    /** The default length of a segment, in seconds */
+    static const double DEFAULT_SEGMENT_LENGTH;
+
+    /** The default overlap between neighbouring segments, in seconds */
+    static const double DEFAULT_OVERLAP;
+
+    /** Perform beat tracking in segments.
+     *  @param settings The tracker whose parameters and deadline are
+     *     used for each segment (its state is not used, but the work
+     *     done in all the segments is added to its stats, and it is
+     *     marked as partial if the deadline stops any segment early,
+     *     in which case only the beats before the point at which the
+     *     first such segment stopped are returned)
+     *  @param events The onsets or peaks in a feature list
+     *  @param segmentLength The length of each segment in seconds;
+     *     the last segment is extended to the end of the events
+     *  @param overlap The overlap between segments in seconds, which
+     *     is limited to half of the segment length
+     *  @param unfilledReturn Pointer to list in which to return
+     *     un-interpolated beats, or NULL
+     *  @return The list of beats, or an empty list if beat tracking fails
+     *  An exception thrown in tracking any segment, such as
+     *  std::bad_alloc, is rethrown here on the calling thread, once
+     *  the segments already started have finished.
+     */
+    static EventList beatTrack(TrackerContext &settings,
+                               const EventList &events,
+                               double segmentLength, double overlap,
+                               EventList *unfilledReturn);
+
+    /** The beats found in one segment */
+    struct Segment {
+        double start;
+        double end;
+        vector<double> beats;
+        vector<double> unfilled;
+        TrackingStats stats;
+        /** Whether tracking was stopped early by the deadline */
+        bool partial;
+        /** If partial, the time of the first event not tracked */
+        double cutoff;
+    };
+
+    /** Joins the beats of the next segment to those of the segments
+     *  before it.
+     *  @param beats The beats of the earlier segments
+     *  @param unfilled Their un-interpolated beats
+     *  @param next The next segment, which starts within the last
+     *     segment joined
+     *  @param overlapEnd The end of the overlap
+     *  @return Whether the sequences were joined at a pair of beats on
+     *     which both agree
+     */
+    static bool join(vector<double> &beats, vector<double> &unfilled,
+                     const Segment &next, double overlapEnd);
+
+protected:
+    /** Tracks the beats of one segment. */
+    static void trackSegment(const TrackerContext &settings,
+                             const EventList &events, Segment &segment);
+
+}; // class SegmentedBeatTracker
+
+#endif
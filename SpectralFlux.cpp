@@ -0,0 +1,219 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+#include "SpectralFlux.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BEATROOT_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(BEATROOT_HAVE_SSE2) && defined(__GNUC__)
+#define BEATROOT_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define BEATROOT_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Each kernel adds the difference for bin i to partial sum i % 4, in
+// order of i, and adds the partial sums together in the same way at
+// the end, so that all give the same result.
+
+/** Handles bins from start to bins (the remainder left by a vector
+ *  kernel, or all of them). */
+static double
+finish(const float *frame, float *prev, int start, int bins, double sums[4])
+{
+    for (int i = start; i < bins; ++i) {
+        float re = frame[i*2];
+        float im = frame[i*2+1];
+        float mag = sqrtf(re * re + im * im);
+        double diff = (double)mag - (double)prev[i];
+        if (diff > 0) sums[i % 4] += diff;
+        prev[i] = mag;
+    }
+    return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+}
+
+static double
+fluxScalar(const float *frame, float *prev, int bins)
+{
+    double sums[4] = { 0, 0, 0, 0 };
+    return finish(frame, prev, 0, bins, sums);
+}
+
+#ifdef BEATROOT_HAVE_SSE2
+static double
+fluxSSE2(const float *frame, float *prev, int bins)
+{
+    const __m128d zero = _mm_setzero_pd();
+    __m128d sum01 = zero, sum23 = zero;
+    int i = 0;
+    for ( ; i + 4 <= bins; i += 4) {
+        __m128 a = _mm_loadu_ps(frame + i*2);
+        __m128 b = _mm_loadu_ps(frame + i*2 + 4);
+        __m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 mag = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(re, re),
+                                            _mm_mul_ps(im, im)));
+        __m128 old = _mm_loadu_ps(prev + i);
+        _mm_storeu_ps(prev + i, mag);
+        __m128d d01 = _mm_sub_pd(_mm_cvtps_pd(mag), _mm_cvtps_pd(old));
+        __m128d d23 = _mm_sub_pd(_mm_cvtps_pd(_mm_movehl_ps(mag, mag)),
+                                 _mm_cvtps_pd(_mm_movehl_ps(old, old)));
+        sum01 = _mm_add_pd(sum01, _mm_max_pd(d01, zero));
+        sum23 = _mm_add_pd(sum23, _mm_max_pd(d23, zero));
+    }
+    double sums[4];
+    _mm_storeu_pd(sums, sum01);
+    _mm_storeu_pd(sums + 2, sum23);
+    return finish(frame, prev, i, bins, sums);
+}
+#endif
+
+#ifdef BEATROOT_HAVE_AVX2
+__attribute__((target("avx2")))
+static double
+fluxAVX2(const float *frame, float *prev, int bins)
+{
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d sum = zero;
+    int i = 0;
+    for ( ; i + 8 <= bins; i += 8) {
+        __m256 a = _mm256_loadu_ps(frame + i*2);
+        __m256 b = _mm256_loadu_ps(frame + i*2 + 8);
+        // Within each 128-bit lane, as for SSE2; this leaves the bins
+        // in the order 0 1 4 5 2 3 6 7, which is put right below
+        __m256 re = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 im = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        __m256 mag = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(re, re),
+                                                  _mm256_mul_ps(im, im)));
+        mag = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(mag),
+                                                     _MM_SHUFFLE(3, 1, 2, 0)));
+        __m256 old = _mm256_loadu_ps(prev + i);
+        _mm256_storeu_ps(prev + i, mag);
+        __m256d lo = _mm256_sub_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(mag)),
+                                   _mm256_cvtps_pd(_mm256_castps256_ps128(old)));
+        __m256d hi = _mm256_sub_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(mag, 1)),
+                                   _mm256_cvtps_pd(_mm256_extractf128_ps(old, 1)));
+        sum = _mm256_add_pd(sum, _mm256_max_pd(lo, zero));
+        sum = _mm256_add_pd(sum, _mm256_max_pd(hi, zero));
+    }
+    double sums[4];
+    _mm256_storeu_pd(sums, sum);
+    return finish(frame, prev, i, bins, sums);
+}
+#endif
+
+#ifdef BEATROOT_HAVE_NEON
+static double
+fluxNEON(const float *frame, float *prev, int bins)
+{
+    const float64x2_t zero = vdupq_n_f64(0);
+    float64x2_t sum01 = zero, sum23 = zero;
+    int i = 0;
+    for ( ; i + 4 <= bins; i += 4) {
+        float32x4x2_t z = vld2q_f32(frame + i*2);
+        float32x4_t mag = vsqrtq_f32(vaddq_f32(vmulq_f32(z.val[0], z.val[0]),
+                                               vmulq_f32(z.val[1], z.val[1])));
+        float32x4_t old = vld1q_f32(prev + i);
+        vst1q_f32(prev + i, mag);
+        float64x2_t d01 = vsubq_f64(vcvt_f64_f32(vget_low_f32(mag)),
+                                    vcvt_f64_f32(vget_low_f32(old)));
+        float64x2_t d23 = vsubq_f64(vcvt_high_f64_f32(mag),
+                                    vcvt_high_f64_f32(old));
+        sum01 = vaddq_f64(sum01, vmaxq_f64(d01, zero));
+        sum23 = vaddq_f64(sum23, vmaxq_f64(d23, zero));
+    }
+    double sums[4];
+    vst1q_f64(sums, sum01);
+    vst1q_f64(sums + 2, sum23);
+    return finish(frame, prev, i, bins, sums);
+}
+#endif
+
+bool
+SpectralFlux::isSupported(Kernel kernel)
+{
+    switch (kernel) {
+    case Scalar:
+        return true;
+    case SSE2:
+#ifdef BEATROOT_HAVE_SSE2
+        return true;
+#else
+        return false;
+#endif
+    case AVX2:
+#ifdef BEATROOT_HAVE_AVX2
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    case NEON:
+#ifdef BEATROOT_HAVE_NEON
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+SpectralFlux::Kernel
+SpectralFlux::getBestKernel()
+{
+    static const Kernel best =
+        isSupported(AVX2) ? AVX2 :
+        isSupported(NEON) ? NEON :
+        isSupported(SSE2) ? SSE2 :
+        Scalar;
+    return best;
+}
+
+const char *
+SpectralFlux::getKernelName(Kernel kernel)
+{
+    switch (kernel) {
+    case Scalar: return "scalar";
+    case SSE2: return "sse2";
+    case AVX2: return "avx2";
+    case NEON: return "neon";
+    }
+    return "";
+}
+
+SpectralFlux::KernelFunction
+SpectralFlux::getKernelFunction(Kernel kernel)
+{
+    switch (kernel) {
+#ifdef BEATROOT_HAVE_SSE2
+    case SSE2: return fluxSSE2;
+#endif
+#ifdef BEATROOT_HAVE_AVX2
+    case AVX2: return fluxAVX2;
+#endif
+#ifdef BEATROOT_HAVE_NEON
+    case NEON: return fluxNEON;
+#endif
+    default: return fluxScalar;
+    }
+}
@@ -0,0 +1,77 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+#ifndef _SPECTRAL_FLUX_H_
+#define _SPECTRAL_FLUX_H_
+
+/** Computes the spectral flux of successive frames of
+ *  frequency-domain audio, i.e. the sum over all bins of the increase
+ *  in magnitude since the previous frame.
+ *
+ *  Several implementations (kernels) are provided, using the vector
+ *  instructions of different processors, and the fastest one
+ *  supported is chosen when first used.  Magnitudes are calculated in
+ *  single precision and the differences summed in double precision,
+ *  with the bins divided between four partial sums in the same way by
+ *  every kernel, so that all kernels give identical results.
+ */
+class SpectralFlux
+{
+public:
+    enum Kernel {
+        Scalar,         ///< portable C++
+        SSE2,           ///< x86 SSE2
+        AVX2,           ///< x86 AVX2
+        NEON            ///< 64-bit ARM NEON
+    };
+
+    /** Calculates the spectral flux of a frame with the fastest
+     *  supported kernel, and updates the previous magnitude spectrum.
+     *  @param frame The frame, as interleaved real and imaginary parts
+     *  @param prev The magnitude spectrum of the previous frame, which
+     *     is replaced with that of this frame
+     *  @param bins The number of frequency bins
+     *  @return The spectral flux
+     */
+    static double compute(const float *frame, float *prev, int bins) {
+        return getKernelFunction(getBestKernel())(frame, prev, bins);
+    }
+
+    /** Calculates the spectral flux of a frame with the given kernel,
+     *  which must be supported (see isSupported()).
+     */
+    static double compute(Kernel kernel, const float *frame, float *prev,
+                          int bins) {
+        return getKernelFunction(kernel)(frame, prev, bins);
+    }
+
+    /** @return Whether the kernel is available in this build and is
+     *  supported by this processor */
+    static bool isSupported(Kernel kernel);
+
+    /** @return The fastest supported kernel */
+    static Kernel getBestKernel();
+
+    static const char *getKernelName(Kernel kernel);
+
+protected:
+    typedef double (*KernelFunction)(const float *, float *, int);
+
+    static KernelFunction getKernelFunction(Kernel kernel);
+
+}; // class SpectralFlux
+
+#endif
@@ -0,0 +1,158 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+#include "ThreadPool.h"
+
+static unsigned long long pack(unsigned long long first, unsigned long long end)
+{
+    return (first << 32) | end;
+}
+
+ThreadPool::ThreadPool(int n) :
+    queues(n > 1 ? n : 1),
+    task(0),
+    generation(0),
+    busy(0),
+    stopping(false)
+{
+    for (int i = 0; i < (int)queues.size(); ++i) {
+        queues[i].range = 0;
+    }
+    // Thread 0 is the caller of run().  If a thread cannot be
+    // started, those already running are stopped before the
+    // exception is passed on, as the destructor will not be called.
+    threads.reserve(queues.size() - 1);
+    try {
+        for (int i = 1; i < (int)queues.size(); ++i) {
+            threads.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+        }
+    } catch (...) {
+        stop();
+        throw;
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    stop();
+}
+
+void ThreadPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        stopping = true;
+    }
+    started.notify_all();
+    for (int i = 0; i < (int)threads.size(); ++i) {
+        threads[i].join();
+    }
+}
+
+void ThreadPool::run(Task &t, int n)
+{
+    if (n <= 0) return;
+    int count = queues.size();
+    if (count == 1 || n == 1) {
+        for (int i = 0; i < n; ++i) t.run(i);
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        // Workers that woke too late to help with the previous batch
+        // may still be looking at the queues
+        while (busy > 0) finished.wait(lock);
+        for (int i = 0; i < count; ++i) {
+            queues[i].range = pack((long long)n * i / count,
+                                   (long long)n * (i + 1) / count);
+        }
+        task = &t;
+        ++generation;
+        ++busy;
+    }
+    started.notify_all();
+    work(&t, 0);
+    std::unique_lock<std::mutex> lock(mutex);
+    --busy;
+    // All queues are empty by now, but tasks taken by other threads
+    // may still be running
+    while (busy > 0) finished.wait(lock);
+    task = 0;
+} // run()
+
+void ThreadPool::workerLoop(int index)
+{
+    unsigned long seen = 0;
+    while (true) {
+        Task *t;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!stopping && generation == seen) started.wait(lock);
+            if (stopping) return;
+            seen = generation;
+            t = task;
+            ++busy;
+        }
+        if (t) work(t, index);
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            --busy;
+        }
+        finished.notify_all();
+    }
+} // workerLoop()
+
+void ThreadPool::work(Task *t, int index)
+{
+    int count = queues.size();
+    int taskIndex;
+    while (popFront(index, taskIndex)) {
+        t->run(taskIndex);
+    }
+    for (int i = 1; i < count; ++i) {
+        int victim = (index + i) % count;
+        while (popBack(victim, taskIndex)) {
+            t->run(taskIndex);
+        }
+    }
+} // work()
+
+bool ThreadPool::popFront(int queue, int &taskIndex)
+{
+    std::atomic<unsigned long long> &range = queues[queue].range;
+    unsigned long long r = range.load();
+    while (true) {
+        unsigned long long first = r >> 32, end = r & 0xffffffffULL;
+        if (first >= end) return false;
+        if (range.compare_exchange_weak(r, pack(first + 1, end))) {
+            taskIndex = (int)first;
+            return true;
+        }
+    }
+} // popFront()
+
+bool ThreadPool::popBack(int queue, int &taskIndex)
+{
+    std::atomic<unsigned long long> &range = queues[queue].range;
+    unsigned long long r = range.load();
+    while (true) {
+        unsigned long long first = r >> 32, end = r & 0xffffffffULL;
+        if (first >= end) return false;
+        if (range.compare_exchange_weak(r, pack(first, end - 1))) {
+            taskIndex = (int)(end - 1);
+            return true;
+        }
+    }
+} // popBack()
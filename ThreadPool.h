@@ -0,0 +1,90 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** A fixed set of worker threads for running a batch of independent
+ *  tasks, numbered 0 to n-1, to completion.
+ *
+ *  The tasks of each batch are divided into contiguous ranges, one per
+ *  thread.  Each thread works through its own range from the front,
+ *  and once that is exhausted it steals tasks from the back of the
+ *  other threads' ranges, so that uneven task costs are balanced out.
+ *  The calling thread takes part in running the batch.
+ */
+class ThreadPool
+{
+public:
+    /** A batch of tasks to be run by the pool. */
+    class Task
+    {
+    public:
+        virtual ~Task() { }
+        /** Runs the task with the given number. */
+        virtual void run(int index) = 0;
+    };
+
+    /** @param threads The total number of threads to use, including
+     *     the calling thread */
+    ThreadPool(int threads);
+    ~ThreadPool();
+
+    int getThreadCount() const { return (int)queues.size(); }
+
+    /** Calls task.run(i) for each i from 0 to n-1, in no particular
+     *  order, and returns when all calls have completed. */
+    void run(Task &task, int n);
+
+protected:
+    /** A range of task numbers, packed as (first << 32 | end) so that
+     *  the owner and thieves can both update it with one CAS. */
+    struct Queue {
+        std::atomic<unsigned long long> range;
+    };
+
+    std::vector<Queue> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable started;
+    std::condition_variable finished;
+    Task *task;
+    unsigned long generation;
+    int busy;
+    bool stopping;
+
+    /** Stops and joins the worker threads */
+    void stop();
+
+    void workerLoop(int index);
+    void work(Task *t, int index);
+
+    bool popFront(int queue, int &taskIndex);
+    bool popBack(int queue, int &taskIndex);
+
+private:
+    ThreadPool(const ThreadPool &);
+    ThreadPool &operator=(const ThreadPool &);
+
+}; // class ThreadPool
+
+#endif
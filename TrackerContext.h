@@ -0,0 +1,103 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+#ifndef _TRACKER_CONTEXT_H_
+#define _TRACKER_CONTEXT_H_
+
+#include "Agent.h"
+#include "Deadline.h"
+#include "Induction.h"
+#include "TrackingStats.h"
+
+/** The settings and working state of a single beat tracker: the
+ *  parameters of tempo induction and beat tracking, the numbering of
+ *  the Agents and the arena in which they are allocated.  A context
+ *  is used by one beat tracking run at a time; trackers with separate
+ *  contexts share no state, and may run concurrently on different
+ *  threads.
+ */
+class TrackerContext
+{
+public:
+    TrackerContext(AgentParameters params = AgentParameters()) :
+        agentParameters(params),
+        useAverageSalience(false),
+        causal(false),
+        partial(false),
+        idCounter(0) { }
+
+    /** User-specifiable beat tracking parameters. */
+    AgentParameters agentParameters;
+
+    /** Tempo induction parameters. */
+    InductionParameters inductionParameters;
+
+    /** Flag for choice between sum and average beat salience values for Agent scores.
+     *  The use of summed saliences favours faster tempi or lower metrical levels. */
+    bool useAverageSalience;
+
+    /** Whether the Agents track the onsets causally, as they are
+     *  detected (see CausalBeatTracker), which changes the default
+     *  decay of their scores (see getDecayFactor()). */
+    bool causal;
+
+    /** The memory in which the Agents of the current run are allocated. */
+    AgentArena arena;
+
+    /** Counters of the work done by this tracker, which are not
+     *  cleared by reset(), so that they cover every run until they
+     *  are cleared explicitly (see TrackingStats). */
+    TrackingStats stats;
+
+    /** The point at which beat tracking stops early with the beats
+     *  found so far, if any.  It is not applied in causal tracking,
+     *  whose beats are returned as they are found. */
+    Deadline deadline;
+
+    /** Whether the latest run was stopped by the deadline before its
+     *  last Event, so that its beats cover only the start of the
+     *  input.  Cleared by reset(). */
+    bool partial;
+
+    /** @return The decay factor of the Agents' scores: that of the
+     *  parameters if greater than zero, otherwise (for the default of
+     *  zero) AgentParameters::DEFAULT_CAUSAL_DECAY_FACTOR in causal
+     *  tracking and zero, for cumulative scores, in batch tracking. */
+    double getDecayFactor() const {
+        if (agentParameters.decayFactor > 0) return agentParameters.decayFactor;
+        return causal ? AgentParameters::DEFAULT_CAUSAL_DECAY_FACTOR : 0.0;
+    }
+
+    /** @return The identity number for the next created Agent */
+    int newAgentId() {
+        return idCounter++;
+    }
+
+    /** Prepares for a new beat tracking run, releasing all Agents
+     *  of the previous one.  Agents are numbered from zero in each
+     *  run, so that the same input always gives the same result. */
+    void reset() {
+        idCounter = 0;
+        partial = false;
+        arena.reset();
+    }
+
+protected:
+    /** The identity number of the next created Agent */
+    int idCounter;
+
+}; // class TrackerContext
+
+#endif
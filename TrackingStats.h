@@ -0,0 +1,157 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+#ifndef _TRACKING_STATS_H_
+#define _TRACKING_STATS_H_
+
+#include <chrono>
+
+/** Statements which update the TrackingStats, compiled only if the
+ *  library is built with BEATROOT_ENABLE_STATS defined, and otherwise
+ *  compiled to nothing. */
+#ifdef BEATROOT_ENABLE_STATS
+#define BEATROOT_STATS(statement) statement
+#else
+#define BEATROOT_STATS(statement)
+#endif
+
+/** Counters of the work done in finding the beats of an input, for
+ *  finding out why some input takes much longer than usual.  They are
+ *  updated only in a build with BEATROOT_ENABLE_STATS defined (see
+ *  isEnabled()); otherwise they remain zero, and cost nothing.
+ *
+ *  The times are in seconds.  Where the work is done on several
+ *  threads (by SegmentedBeatTracker, or the stages of a Pipeline),
+ *  the times of all the threads are added together.
+ */
+class TrackingStats
+{
+public:
+    TrackingStats() { clear(); }
+
+    /** @return Whether the counters are updated in this build */
+    static bool isEnabled() {
+#ifdef BEATROOT_ENABLE_STATS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /** The number of Agents created by tempo induction */
+    long inducedAgents;
+
+    /** The number of Agents created by forking, when an Agent accepts
+     *  an onset outside its inner margin */
+    long forks;
+
+    /** The number of Agents terminated for having no onset matching
+     *  their beat predictions for their expiry time */
+    long expired;
+
+    /** The number of Agents removed as duplicates of others */
+    long duplicates;
+
+    /** The number of Agents removed to keep to the maximum number
+     *  (see AgentParameters::maxAgents) */
+    long pruned;
+
+    /** The number of Agents removed as unable to overtake the best
+     *  (see AgentParameters::pruneDominated) */
+    long dominated;
+
+    /** The number of onsets offered to the Agents */
+    long onsets;
+
+    /** The number of times an Agent has considered an onset as a
+     *  possible beat (Agent::considerAsBeat() or its equivalent) */
+    long considered;
+
+    /** The largest number of Agents to which an onset was offered,
+     *  and the sum over all onsets of that number */
+    long peakAgents;
+    long agentSum;
+
+    /** The time taken to calculate the onset detection function from
+     *  the frames of audio (which, in causal mode, includes finding
+     *  the onsets and tracking the beats as the frames arrive) */
+    double frameTime;
+
+    /** The time taken to find the onsets (batch mode) */
+    double onsetTime;
+
+    /** The time taken by tempo induction */
+    double inductionTime;
+
+    /** The time taken to offer the onsets to the Agents */
+    double trackingTime;
+
+    /** The time taken to interpolate missing beats */
+    double fillTime;
+
+    /** @return The mean number of Agents to which each onset was offered */
+    double getMeanAgents() const {
+        return onsets ? double(agentSum) / onsets : 0;
+    }
+
+    /** @return The mean number of Agents that considered each onset */
+    double getConsideredPerOnset() const {
+        return onsets ? double(considered) / onsets : 0;
+    }
+
+    void clear() {
+        inducedAgents = forks = expired = duplicates = pruned = dominated = 0;
+        onsets = considered = peakAgents = agentSum = 0;
+        frameTime = onsetTime = inductionTime = trackingTime = fillTime = 0;
+    }
+
+    /** Adds the counts and times of another tracker to these. */
+    void add(const TrackingStats &other) {
+        inducedAgents += other.inducedAgents;
+        forks += other.forks;
+        expired += other.expired;
+        duplicates += other.duplicates;
+        pruned += other.pruned;
+        dominated += other.dominated;
+        onsets += other.onsets;
+        considered += other.considered;
+        if (other.peakAgents > peakAgents) peakAgents = other.peakAgents;
+        agentSum += other.agentSum;
+        frameTime += other.frameTime;
+        onsetTime += other.onsetTime;
+        inductionTime += other.inductionTime;
+        trackingTime += other.trackingTime;
+        fillTime += other.fillTime;
+    }
+
+    /** Adds the time from its construction to its destruction to one
+     *  of the times of a TrackingStats. */
+    class Timer
+    {
+    public:
+        Timer(double &t) :
+            total(t), start(std::chrono::steady_clock::now()) { }
+        ~Timer() {
+            total += std::chrono::duration<double>
+                (std::chrono::steady_clock::now() - start).count();
+        }
+    protected:
+        double &total;
+        std::chrono::steady_clock::time_point start;
+    };
+
+}; // class TrackingStats
+
+#endif
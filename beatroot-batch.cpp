@@ -0,0 +1,407 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+/* beatroot-batch: tracks the beats in many audio files, on a pool of
+ * worker threads in a single process.
+ */
+
+#include "AudioFileReader.h"
+#include "BeatRootProcessor.h"
+#include "Pipeline.h"
+#include "SegmentedBeatTracker.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::string;
+
+static void usage(const char *name)
+{
+    std::cerr <<
+        "Usage: " << name << " [options] [file ...]\n"
+        "\n"
+        "Tracks the beats in WAV or raw PCM audio files, writing them as CSV\n"
+        "with one row per beat: file,beat,time (in seconds).\n"
+        "\n"
+        "  -l FILE     Read the list of audio files from FILE, one per line\n"
+        "              (\"-\" for standard input), as well as the command line\n"
+        "  -o FILE     Write the beats to FILE rather than standard output\n"
+        "  -j N        Use N worker threads (default: one per core)\n"
+        "  -s          Process each file in three stages, on three threads\n"
+        "              per worker (reading, spectral analysis and tracking),\n"
+        "              for faster results from a few long files\n"
+        "  -c          Store the onset detection function compactly, in\n"
+        "              half the memory, for very long files (the beats may\n"
+        "              differ slightly)\n"
+        "  -g SECONDS  Track the beats of each file in overlapping segments\n"
+        "              of this length, in parallel, and join them; threads\n"
+        "              not needed for separate files are used for segments\n"
+        "  -a N        Keep at most N beat tracking agents, for faster\n"
+        "              tracking of noisy audio (default: no limit)\n"
+        "  -p          Remove beat tracking agents as soon as they cannot\n"
+        "              overtake the best, rather than when they expire\n"
+        "  -t SECONDS  Stop tracking the beats of a file after this time\n"
+        "              from the start of its processing, writing the\n"
+        "              beats found until then, and reporting it\n"
+        "  -r E:R:C    Read files that are not WAV files as raw PCM with\n"
+        "              encoding E (s8, s16, s24, s32, f32 or f64), sample\n"
+        "              rate R and C channels, e.g. s16:44100:2\n"
+        "\n"
+        "The throughput, in seconds of audio per second of elapsed time, is\n"
+        "reported on standard error.\n";
+}
+
+/** Quotes a CSV field if necessary */
+static string csvField(const string &s)
+{
+    if (s.find_first_of(",\"\n\r") == string::npos) return s;
+    string q = "\"";
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '"') q += '"';
+        q += s[i];
+    }
+    return q + "\"";
+}
+
+/** Writes the results for each file in the order of the file list,
+ *  as soon as those for all earlier files are complete. */
+class OrderedOutput
+{
+public:
+    OrderedOutput(std::ostream &o, size_t n) :
+        out(o), results(n), done(n, false), next(0) { }
+
+    void complete(size_t index, const string &result) {
+        std::lock_guard<std::mutex> guard(mutex);
+        results[index] = result;
+        done[index] = true;
+        while (next < done.size() && done[next]) {
+            out << results[next];
+            string().swap(results[next]);
+            ++next;
+        }
+    }
+
+protected:
+    std::ostream &out;
+    std::vector<string> results;
+    std::vector<bool> done;
+    size_t next;
+    std::mutex mutex;
+};
+
+/** Reads audio from a file for a Pipeline, releasing the file's pages
+ *  once they have been read */
+class FileSource : public Pipeline::PCMSource
+{
+public:
+    FileSource(AudioFileReader &r) :
+        PCMSource(r.getData(), r.getFrameCount(), r.getFormat()),
+        reader(r) { }
+
+    size_t read(float *mono, size_t n) {
+        n = PCMSource::read(mono, n);
+        reader.release(position);
+        return n;
+    }
+
+protected:
+    AudioFileReader &reader;
+};
+
+/** Analyses the files of the list, each task being a worker which
+ *  takes the next file from the list until none is left.  Each worker
+ *  keeps a processor, which is reused from one file to the next unless
+ *  the sample rate changes. */
+class BatchTask : public ThreadPool::Task
+{
+public:
+    BatchTask(const std::vector<string> &f,
+              const AudioFileReader::RawFormat &r,
+              OrderedOutput &o, int workers, bool s,
+              double g, int t, bool c, int a, bool p, double l) :
+        files(f), raw(r), output(o), staged(s),
+        segmentLength(g), trackThreads(t), compact(c), maxAgents(a),
+        pruneDominated(p), timeLimit(l),
+        processors(workers, (BeatRootProcessor *)0),
+        nextFile(0), failed(0), partial(0), audioSeconds(0) { }
+
+    ~BatchTask() {
+        for (size_t i = 0; i < processors.size(); ++i) delete processors[i];
+    }
+
+    void run(int worker) {
+        AudioFileReader reader;
+        size_t i;
+        while ((i = nextFile++) < files.size()) {
+            std::ostringstream result;
+            if (!reader.open(files[i], raw)) {
+                std::lock_guard<std::mutex> guard(mutex);
+                std::cerr << files[i] << ": " << reader.getError() << std::endl;
+                ++failed;
+                output.complete(i, "");
+                continue;
+            }
+            float rate = reader.getSampleRate();
+            BeatRootProcessor *&proc = processors[worker];
+            if (!proc || proc->getSampleRate() != rate) {
+                delete proc;
+                AgentParameters params;
+                params.threadCount = trackThreads;
+                params.maxAgents = maxAgents;
+                params.pruneDominated = pruneDominated;
+                proc = new BeatRootProcessor(rate, params);
+                proc->setSegmented(segmentLength,
+                                   SegmentedBeatTracker::DEFAULT_OVERLAP);
+                proc->setCompact(compact);
+            } else {
+                proc->reset();
+            }
+            if (timeLimit > 0) proc->setDeadline(Deadline::after(timeLimit));
+            EventList beats;
+            if (staged) {
+                FileSource source(reader);
+                beats = Pipeline(*proc).run(source, 0);
+            } else {
+                beats = track(*proc, reader);
+            }
+            // Frame times are those of their centres
+            double offset = (proc->getFFTSize() / 2) / double(rate);
+            string name = csvField(files[i]);
+            char buf[32];
+            int index = 0;
+            for (EventList::const_iterator b = beats.begin(); b != beats.end(); ++b) {
+                snprintf(buf, sizeof(buf), "%.6f", b->time + offset);
+                result << name << ',' << index++ << ',' << buf << '\n';
+            }
+            output.complete(i, result.str());
+            std::lock_guard<std::mutex> guard(mutex);
+            if (proc->isPartial()) {
+                std::cerr << files[i] << ": time limit reached, beats are "
+                          << "partial" << std::endl;
+                ++partial;
+            }
+            audioSeconds += reader.getFrameCount() / double(rate);
+            reader.close();
+        }
+    }
+
+    /** Processes the audio in a single stage, reading each frame
+     *  from the file's pages in place, and releasing the pages once
+     *  they have been processed */
+    static EventList track(BeatRootProcessor &proc, AudioFileReader &reader) {
+        const unsigned char *data = reader.getData();
+        const PCMFormat &format = reader.getFormat();
+        size_t frames = reader.getFrameCount();
+        size_t position = 0;
+        while (position < frames) {
+            size_t n = frames - position;
+            bool atEnd = (n <= BLOCK_SIZE);
+            if (!atEnd) n = BLOCK_SIZE;
+            position += proc.processPCM
+                (data + position * format.getFrameBytes(), n, format, atEnd);
+            reader.release(position);
+        }
+        return proc.beatTrack(0);
+    }
+
+    int getFailedCount() const { return failed; }
+    int getPartialCount() const { return partial; }
+    double getAudioSeconds() const { return audioSeconds; }
+
+protected:
+    /** The number of sample frames given to the processor at a time */
+    static const size_t BLOCK_SIZE = 1 << 20;
+
+    const std::vector<string> &files;
+    AudioFileReader::RawFormat raw;
+    OrderedOutput &output;
+    bool staged;
+    double segmentLength;
+    int trackThreads;
+    bool compact;
+    int maxAgents;
+    bool pruneDominated;
+    double timeLimit;
+    std::vector<BeatRootProcessor *> processors;
+    std::atomic<size_t> nextFile;
+    std::mutex mutex;
+    int failed;
+    int partial;
+    double audioSeconds;
+};
+
+static bool readList(const string &path, std::vector<string> &files)
+{
+    std::ifstream in;
+    std::istream *is = &std::cin;
+    if (path != "-") {
+        in.open(path.c_str());
+        if (!in) return false;
+        is = &in;
+    }
+    string line;
+    while (std::getline(*is, line)) {
+        if (!line.empty() && line[line.size()-1] == '\r') {
+            line.erase(line.size()-1);
+        }
+        if (!line.empty()) files.push_back(line);
+    }
+    return true;
+}
+
+static bool parseRaw(const string &spec, AudioFileReader::RawFormat &raw)
+{
+    size_t a = spec.find(':');
+    size_t b = (a == string::npos) ? a : spec.find(':', a + 1);
+    if (b == string::npos) return false;
+    if (!AudioFileReader::parseEncoding(spec.substr(0, a), raw.format.encoding)) {
+        return false;
+    }
+    raw.sampleRate = float(atof(spec.substr(a + 1, b - a - 1).c_str()));
+    raw.format.channels = atoi(spec.substr(b + 1).c_str());
+    return raw.sampleRate > 0 && raw.format.channels > 0;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<string> files;
+    AudioFileReader::RawFormat raw;
+    string outputPath;
+    int threads = std::thread::hardware_concurrency();
+    if (threads < 1) threads = 1;
+    bool staged = false;
+    double segmentLength = 0;
+    bool compact = false;
+    int maxAgents = AgentParameters::DEFAULT_MAX_AGENTS;
+    bool pruneDominated = false;
+    double timeLimit = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "-h" || arg == "--help") {
+            usage(argv[0]);
+            return 0;
+        } else if (arg == "-l" && hasValue) {
+            if (!readList(argv[++i], files)) {
+                std::cerr << argv[0] << ": cannot read file list "
+                          << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "-o" && hasValue) {
+            outputPath = argv[++i];
+        } else if (arg == "-j" && hasValue) {
+            threads = atoi(argv[++i]);
+            if (threads < 1) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (arg == "-s") {
+            staged = true;
+        } else if (arg == "-c") {
+            compact = true;
+        } else if (arg == "-g" && hasValue) {
+            segmentLength = atof(argv[++i]);
+            if (!(segmentLength > 0)) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (arg == "-a" && hasValue) {
+            maxAgents = atoi(argv[++i]);
+            if (maxAgents < 1) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (arg == "-p") {
+            pruneDominated = true;
+        } else if (arg == "-t" && hasValue) {
+            timeLimit = atof(argv[++i]);
+            if (!(timeLimit > 0)) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (arg == "-r" && hasValue) {
+            if (!parseRaw(argv[++i], raw)) {
+                std::cerr << argv[0] << ": bad raw format " << argv[i]
+                          << std::endl;
+                return 2;
+            }
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    if (files.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::ofstream outFile;
+    if (outputPath != "") {
+        outFile.open(outputPath.c_str());
+        if (!outFile) {
+            std::cerr << argv[0] << ": cannot write " << outputPath << std::endl;
+            return 1;
+        }
+    }
+    std::ostream &out = (outputPath != "") ? outFile : std::cout;
+    out << "file,beat,time\n";
+
+    int workers = threads;
+    if (workers > (int)files.size()) workers = files.size();
+    // Any threads left over are shared among the workers' trackers
+    int trackThreads = threads / workers;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    OrderedOutput output(out, files.size());
+    BatchTask task(files, raw, output, workers, staged,
+                   segmentLength, trackThreads, compact, maxAgents,
+                   pruneDominated, timeLimit);
+    ThreadPool pool(workers);
+    pool.run(task, workers);
+
+    double elapsed = std::chrono::duration<double>
+        (std::chrono::steady_clock::now() - start).count();
+    out.flush();
+
+    int failed = task.getFailedCount();
+    double audio = task.getAudioSeconds();
+    fprintf(stderr, "%d file(s), %d failed: %.1f s of audio in %.2f s "
+            "on %d thread(s), %.1f s of audio per second\n",
+            int(files.size()), failed, audio, elapsed, threads,
+            elapsed > 0 ? audio / elapsed : 0.0);
+    if (timeLimit > 0) {
+        fprintf(stderr, "%d file(s) stopped at the time limit\n",
+                task.getPartialCount());
+    }
+
+    return (failed > 0 || !out) ? 1 : 0;
+}
@@ -0,0 +1,643 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+/* beatroot-bench: times each stage of BeatRoot separately on
+ * deterministic synthetic inputs, writing the results as JSON, and
+ * optionally compares them with the results of an earlier run.
+ */
+
+#include "BeatRootProcessor.h"
+#include "Peaks.h"
+#include "Pipeline.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+using std::string;
+
+// Every allocation made through operator new is counted, so that the
+// allocations made by each stage can be reported
+
+static std::atomic<size_t> allocations(0);
+static std::atomic<size_t> allocatedBytes(0);
+
+void *operator new(size_t size)
+{
+    ++allocations;
+    allocatedBytes += size;
+    void *p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    free(p);
+}
+#endif
+
+/** A synthetic input: a click track at a constant tempo or a tempo
+ *  ramp, or noise bursts at random intervals (dense onsets). */
+struct Input {
+    enum Kind { Click, Ramp, Noise };
+    const char *name;
+    Kind kind;
+    double bpm;
+    double endBpm;
+};
+
+static const Input inputs[] = {
+    { "click-60", Input::Click, 60, 60 },
+    { "click-120", Input::Click, 120, 120 },
+    { "click-200", Input::Click, 200, 200 },
+    { "ramp-60-200", Input::Ramp, 60, 200 },
+    { "dense-noise", Input::Noise, 0, 0 },
+};
+
+/** Synthesises an input as it is read, so that inputs of any length
+ *  take no memory.  The same input always gives the same audio. */
+class Synthesiser : public Pipeline::Source
+{
+public:
+    Synthesiser(const Input &in, double d, float r) :
+        input(in), duration(d), rate(r),
+        length(size_t(d * r)), position(0), seed(1),
+        next(0.5), count(0), burst(0), level(0) { }
+
+    size_t read(float *mono, size_t n) {
+        if (n > length - position) n = length - position;
+        for (size_t i = 0; i < n; ++i, ++position) {
+            if (position >= size_t(next * rate)) start();
+            float value = float(0.01 * noise());
+            if (burst > 0) {
+                --burst;
+                value += float(level * noise());
+                level *= decay;
+            }
+            mono[i] = value;
+        }
+        return n;
+    }
+
+protected:
+    /** Starts the burst for an onset, and schedules the next one */
+    void start() {
+        burst = int(0.01 * rate);
+        decay = exp(-1 / (0.002 * rate));
+        switch (input.kind) {
+        case Input::Click:
+        case Input::Ramp: {
+            level = (count % 4 == 0) ? 1.0 : 0.6;
+            double bpm = input.bpm +
+                (input.endBpm - input.bpm) * next / duration;
+            next += 60 / bpm;
+            break;
+        }
+        case Input::Noise:
+            level = 0.2 + 0.8 * (noise() + 0.5);
+            next += 0.01 + 0.19 * (noise() + 0.5);
+            break;
+        }
+        ++count;
+    }
+
+    double noise() {
+        seed = seed * 1103515245u + 12345u;
+        return ((seed >> 8) & 0xffffff) / double(0x1000000) - 0.5;
+    }
+
+    const Input &input;
+    double duration;
+    float rate;
+    size_t length;
+    size_t position;
+    unsigned int seed;
+    double next;
+    int count;
+    int burst;
+    double level;
+    double decay;
+};
+
+/** The Hann-windowed complex FFT of a generic host (as in
+ *  vamp-simple-host), for comparison with the processor's own
+ *  transform.  Its tables are made once, and it does not allocate. */
+class HostTransform
+{
+public:
+    HostTransform(int n) :
+        size(n), reversed(n), window(n), re(n), im(n),
+        cosines(n/2), sines(n/2) {
+        for (int i = 0, j = 0; i < n; ++i) {
+            reversed[i] = j;
+            int bit = n >> 1;
+            for ( ; j & bit; bit >>= 1) j ^= bit;
+            j ^= bit;
+        }
+        for (int i = 0; i < n; ++i) window[i] = 0.5 - 0.5 * cos(2 * M_PI * i / n);
+        for (int i = 0; i < n/2; ++i) {
+            cosines[i] = cos(2 * M_PI * i / n);
+            sines[i] = -sin(2 * M_PI * i / n);
+        }
+    }
+
+    /** Transforms n samples, giving the real and imaginary parts of
+     *  bins 0 to n/2, interleaved, as a host gives them. */
+    void forward(const float *samples, float *output) {
+        for (int i = 0; i < size; ++i) {
+            re[reversed[i]] = samples[i] * window[i];
+            im[i] = 0;
+        }
+        for (int half = 1; half < size; half <<= 1) {
+            int step = size / (half * 2);
+            for (int i = 0; i < size; i += half * 2) {
+                for (int k = 0; k < half; ++k) {
+                    double c = cosines[k * step], s = sines[k * step];
+                    double tr = re[i+k+half] * c - im[i+k+half] * s;
+                    double ti = re[i+k+half] * s + im[i+k+half] * c;
+                    re[i+k+half] = re[i+k] - tr;
+                    im[i+k+half] = im[i+k] - ti;
+                    re[i+k] += tr;
+                    im[i+k] += ti;
+                }
+            }
+        }
+        for (int i = 0; i <= size/2; ++i) {
+            output[i*2] = float(re[i]);
+            output[i*2+1] = float(im[i]);
+        }
+    }
+
+protected:
+    int size;
+    vector<int> reversed;
+    vector<double> window, re, im, cosines, sines;
+};
+
+/** The measurements of one stage on one input */
+struct Result {
+    string input;
+    double duration;
+    string stage;
+    const char *unit;
+    size_t count;
+    double ns;
+    size_t allocations;
+    size_t bytes;
+    int peakAgents;         ///< or -1 if not applicable
+
+    double nsPerUnit() const { return count ? ns / count : 0; }
+};
+
+/** Accumulates the time taken, and the allocations made, over one or
+ *  more intervals */
+class Meter
+{
+public:
+    Meter() : ns(0), count(0), bytes(0) { }
+
+    void start() {
+        startCount = allocations;
+        startBytes = allocatedBytes;
+        startTime = std::chrono::steady_clock::now();
+    }
+
+    void stop() {
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        ns += std::chrono::duration<double, std::nano>(end - startTime).count();
+        count += allocations - startCount;
+        bytes += allocatedBytes - startBytes;
+    }
+
+    Result result(const Input &input, double duration, const char *stage,
+                  const char *unit, size_t units, int peakAgents = -1) const {
+        Result r;
+        r.input = input.name;
+        r.duration = duration;
+        r.stage = stage;
+        r.unit = unit;
+        r.count = units;
+        r.ns = ns;
+        r.allocations = count;
+        r.bytes = bytes;
+        r.peakAgents = peakAgents;
+        return r;
+    }
+
+protected:
+    double ns;
+    size_t count;
+    size_t bytes;
+    size_t startCount;
+    size_t startBytes;
+    std::chrono::steady_clock::time_point startTime;
+};
+
+static const float rate = 44100;
+
+/** Times the processing of each frame, from the host's transform
+ *  (hostTransform and processFrame) and from time-domain samples
+ *  (processTimeDomainFrame), returning the onset detection function */
+static void benchFrames(const Input &input, double duration,
+                        vector<Result> &results, vector<double> &flux)
+{
+    BeatRootProcessor host(rate, AgentParameters());
+    BeatRootProcessor own(rate, AgentParameters());
+    int fftSize = own.getFFTSize(), hopSize = own.getHopSize();
+    HostTransform transform(fftSize);
+    vector<float> frame(fftSize, 0.f), spectrum(fftSize + 2);
+    Synthesiser source(input, duration, rate);
+    flux.clear();
+    flux.reserve(size_t(duration * rate) / hopSize + 1);
+    Meter transformMeter, frameMeter, timeDomainMeter;
+    // The frames are those of processSamples(), without the
+    // zero-padded frames at the end
+    int fill = int(source.read(&frame[0], fftSize));
+    while (fill == fftSize) {
+        transformMeter.start();
+        transform.forward(&frame[0], &spectrum[0]);
+        transformMeter.stop();
+        const float *s = &spectrum[0];
+        frameMeter.start();
+        host.processFrame(&s);
+        frameMeter.stop();
+        timeDomainMeter.start();
+        double f = own.computeTimeDomainFlux(&frame[0]);
+        own.addFlux(f);
+        timeDomainMeter.stop();
+        flux.push_back(f);
+        memmove(&frame[0], &frame[hopSize], (fftSize - hopSize) * sizeof(float));
+        fill = fftSize - hopSize +
+            int(source.read(&frame[fftSize - hopSize], hopSize));
+    }
+    size_t frames = flux.size();
+    results.push_back(transformMeter.result(input, duration, "hostTransform",
+                                            "frame", frames));
+    results.push_back(frameMeter.result(input, duration, "processFrame",
+                                        "frame", frames));
+    results.push_back(timeDomainMeter.result(input, duration,
+                                             "processTimeDomainFrame",
+                                             "frame", frames));
+}
+
+/** Times onset detection, tempo induction, beat tracking and the
+ *  interpolation of beats, on the onset detection function */
+static void benchOnsets(const Input &input, double duration,
+                        const vector<double> &flux, vector<Result> &results)
+{
+    double hopTime = BeatRootProcessor(rate, AgentParameters()).getHopSize()
+        / double(rate);
+    vector<double> normalised(flux);
+    Meter normaliseMeter;
+    normaliseMeter.start();
+    Peaks::normalise(normalised);
+    normaliseMeter.stop();
+    results.push_back(normaliseMeter.result(input, duration, "normalise",
+                                            "frame", flux.size()));
+
+    // As BeatRootProcessor finds its onsets
+    Meter peaksMeter;
+    peaksMeter.start();
+    vector<int> peaks = Peaks::findPeaks(normalised, (int)lrint(0.06 / hopTime),
+                                         0.35, 0.84, true);
+    peaksMeter.stop();
+    results.push_back(peaksMeter.result(input, duration, "findPeaks",
+                                        "frame", flux.size()));
+    double minSalience = Peaks::min(normalised);
+    EventList onsets;
+    for (size_t i = 0; i < peaks.size(); ++i) {
+        Event e = BeatTracker::newBeat(peaks[i] * hopTime, 0);
+        e.salience = normalised[peaks[i]] - minSalience;
+        onsets.push_back(e);
+    }
+
+    // As BeatTracker::beatTrack() tracks them, with the number of
+    // Agents counted after each onset
+    TrackerContext context;
+    Meter inductionMeter;
+    inductionMeter.start();
+    AgentList agents = Induction::beatInduction(context, onsets);
+    inductionMeter.stop();
+    results.push_back(inductionMeter.result(input, duration, "beatInduction",
+                                            "onset", onsets.size()));
+
+    size_t peakAgents = agents.size();
+    Meter trackMeter;
+    trackMeter.start();
+    agents.startTracking();
+    for (EventList::const_iterator i = onsets.begin(); i != onsets.end(); ++i) {
+        agents.trackEvent(*i);
+        if (agents.size() > peakAgents) peakAgents = agents.size();
+    }
+    agents.finishTracking();
+    trackMeter.stop();
+    results.push_back(trackMeter.result(input, duration, "beatTrack", "onset",
+                                        onsets.size(), int(peakAgents)));
+
+    Meter fillMeter;
+    fillMeter.start();
+    Agent *best = agents.bestAgent();
+    EventList beats;
+    if (best) {
+        beats = best->getEvents();
+        best->fillBeats(beats);
+    }
+    fillMeter.stop();
+    results.push_back(fillMeter.result(input, duration, "fillBeats", "beat",
+                                       beats.size()));
+}
+
+/** Times the whole of the processing of the audio, on one thread and
+ *  in the three stages of a Pipeline */
+static void benchStreams(const Input &input, double duration,
+                         vector<Result> &results)
+{
+    size_t frames = 0;
+    {
+        BeatRootProcessor processor(rate, AgentParameters());
+        Synthesiser source(input, duration, rate);
+        Meter meter;
+        meter.start();
+        float block[4096];
+        size_t n;
+        while ((n = source.read(block, 4096)) > 0) {
+            processor.processSamples(block, int(n));
+        }
+        EventList beats = processor.beatTrack(0);
+        meter.stop();
+        frames = size_t(duration * rate) / processor.getHopSize();
+        results.push_back(meter.result(input, duration, "processSamples",
+                                       "frame", frames));
+    }
+    {
+        BeatRootProcessor processor(rate, AgentParameters());
+        Synthesiser source(input, duration, rate);
+        Pipeline pipeline(processor);
+        Meter meter;
+        meter.start();
+        EventList beats = pipeline.run(source, 0);
+        meter.stop();
+        results.push_back(meter.result(input, duration, "pipeline",
+                                       "frame", frames));
+    }
+}
+
+/** Keeps the faster of two measurements of the same stages */
+static void keepFaster(vector<Result> &best, const vector<Result> &latest)
+{
+    if (best.empty()) {
+        best = latest;
+        return;
+    }
+    for (size_t i = 0; i < best.size() && i < latest.size(); ++i) {
+        if (latest[i].ns < best[i].ns) best[i] = latest[i];
+    }
+}
+
+static void writeJSON(std::ostream &out, const vector<Result> &results)
+{
+    out << "{\n  \"sample_rate\": " << rate
+        << ",\n  \"kernel\": \""
+        << SpectralFlux::getKernelName(SpectralFlux::getBestKernel())
+        << "\",\n  \"results\": [\n";
+    char line[512];
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &r = results[i];
+        snprintf(line, sizeof(line),
+                 "    { \"input\": \"%s\", \"duration\": %g, \"stage\": \"%s\", "
+                 "\"unit\": \"%s\", \"count\": %zu, \"ns_per_%s\": %.1f, "
+                 "\"allocations\": %zu, \"allocated_bytes\": %zu",
+                 r.input.c_str(), r.duration, r.stage.c_str(), r.unit,
+                 r.count, r.unit, r.nsPerUnit(), r.allocations, r.bytes);
+        out << line;
+        if (r.peakAgents >= 0) out << ", \"peak_agents\": " << r.peakAgents;
+        out << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+/** @return The value of a field in a line of the JSON written by
+ *  writeJSON(), or an empty string if there is none */
+static string field(const string &line, const string &name)
+{
+    string key = "\"" + name + "\": ";
+    size_t i = line.find(key);
+    if (i == string::npos) return "";
+    i += key.size();
+    if (line[i] == '"') {
+        size_t end = line.find('"', i + 1);
+        return line.substr(i + 1, end - i - 1);
+    }
+    size_t end = line.find_first_of(",}", i);
+    return line.substr(i, end - i);
+}
+
+/** Reads the results of an earlier run, as written by writeJSON() */
+static bool readJSON(const string &filename, vector<Result> &results)
+{
+    std::ifstream in(filename.c_str());
+    if (!in) return false;
+    string line;
+    while (std::getline(in, line)) {
+        string stage = field(line, "stage");
+        if (stage == "") continue;
+        Result r;
+        r.input = field(line, "input");
+        r.duration = atof(field(line, "duration").c_str());
+        r.stage = stage;
+        r.unit = "";
+        r.count = strtoul(field(line, "count").c_str(), 0, 10);
+        r.ns = atof(field(line, "ns_per_" + field(line, "unit")).c_str()) * r.count;
+        r.allocations = strtoul(field(line, "allocations").c_str(), 0, 10);
+        r.bytes = strtoul(field(line, "allocated_bytes").c_str(), 0, 10);
+        string agents = field(line, "peak_agents");
+        r.peakAgents = (agents == "") ? -1 : atoi(agents.c_str());
+        results.push_back(r);
+    }
+    return true;
+}
+
+/** Compares the results with those of the baseline, reporting each
+ *  stage that is slower by more than the tolerance (a fraction), or
+ *  makes more allocations, or whose peak number of Agents has changed.
+ *  @return The number of regressions */
+static int compare(const vector<Result> &results,
+                   const vector<Result> &baseline, double tolerance)
+{
+    int regressions = 0;
+    fprintf(stderr, "\n%-12s %6s %-22s %12s %12s %8s\n", "input", "length",
+            "stage", "baseline ns", "ns", "change");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &r = results[i];
+        const Result *b = 0;
+        for (size_t j = 0; j < baseline.size() && !b; ++j) {
+            if (baseline[j].input == r.input &&
+                baseline[j].duration == r.duration &&
+                baseline[j].stage == r.stage) b = &baseline[j];
+        }
+        if (!b) continue;
+        double change = (b->nsPerUnit() > 0) ?
+            r.nsPerUnit() / b->nsPerUnit() - 1 : 0;
+        string flags;
+        if (change > tolerance) flags += " SLOWER";
+        if (r.allocations > b->allocations) flags += " MORE-ALLOCATIONS";
+        if (r.peakAgents != b->peakAgents) flags += " AGENTS-CHANGED";
+        if (flags != "") ++regressions;
+        fprintf(stderr, "%-12s %6g %-22s %12.1f %12.1f %+7.1f%%%s\n",
+                r.input.c_str(), r.duration, r.stage.c_str(),
+                b->nsPerUnit(), r.nsPerUnit(), change * 100, flags.c_str());
+    }
+    fprintf(stderr, "%d regression(s)\n", regressions);
+    return regressions;
+}
+
+static void usage(const char *name)
+{
+    std::cerr <<
+        "Usage: " << name << " [-d SECONDS[,SECONDS...]] [-r N] [-o FILE]\n"
+        "       [-c BASELINE] [-t PERCENT]\n"
+        "\n"
+        "Times each stage of BeatRoot separately on synthetic click tracks\n"
+        "(60, 120 and 200 bpm, and a ramp from 60 to 200 bpm) and dense noise\n"
+        "onsets, writing the time per frame, onset or beat, the allocations\n"
+        "made, and the peak number of Agents as JSON.\n"
+        "\n"
+        "  -d SECONDS   Lengths of the inputs (default 30,600,7200)\n"
+        "  -r N         Run each input N times, keeping the fastest (default 1)\n"
+        "  -o FILE      Write the JSON to FILE rather than standard output\n"
+        "  -c BASELINE  Compare with the JSON of an earlier run, reporting\n"
+        "               regressions and exiting with status 1 if any are found\n"
+        "  -t PERCENT   Slowdown tolerated in comparison (default 10)\n";
+}
+
+int main(int argc, char **argv)
+{
+    vector<double> durations;
+    durations.push_back(30);
+    durations.push_back(600);
+    durations.push_back(7200);
+    int repeats = 1;
+    string output, baselineFile;
+    double tolerance = 10;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        string value = argv[++i];
+        if (arg == "-d") {
+            durations.clear();
+            const char *p = value.c_str();
+            char *end;
+            while (*p) {
+                durations.push_back(strtod(p, &end));
+                if (end == p || !(durations.back() > 0)) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                p = (*end == ',') ? end + 1 : end;
+            }
+        }
+        else if (arg == "-r") repeats = atoi(value.c_str());
+        else if (arg == "-o") output = value;
+        else if (arg == "-c") baselineFile = value;
+        else if (arg == "-t") tolerance = atof(value.c_str());
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (durations.empty() || repeats < 1 || tolerance < 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    vector<Result> baseline;
+    if (baselineFile != "" && !readJSON(baselineFile, baseline)) {
+        std::cerr << "Failed to read baseline " << baselineFile << std::endl;
+        return 1;
+    }
+
+    vector<Result> results;
+    int n = sizeof(inputs) / sizeof(inputs[0]);
+    for (size_t d = 0; d < durations.size(); ++d) {
+        for (int i = 0; i < n; ++i) {
+            std::cerr << inputs[i].name << ", " << durations[d] << "s..."
+                      << std::endl;
+            vector<Result> best;
+            for (int k = 0; k < repeats; ++k) {
+                vector<Result> latest;
+                vector<double> flux;
+                benchFrames(inputs[i], durations[d], latest, flux);
+                benchOnsets(inputs[i], durations[d], flux, latest);
+                benchStreams(inputs[i], durations[d], latest);
+                keepFaster(best, latest);
+            }
+            results.insert(results.end(), best.begin(), best.end());
+        }
+    }
+
+    if (output != "") {
+        std::ofstream out(output.c_str());
+        writeJSON(out, results);
+        if (!out) {
+            std::cerr << "Failed to write " << output << std::endl;
+            return 1;
+        }
+    } else {
+        writeJSON(std::cout, results);
+    }
+
+    if (!baseline.empty() && compare(results, baseline, tolerance / 100) > 0) {
+        return 1;
+    }
+    return 0;
+}
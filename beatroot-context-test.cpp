@@ -0,0 +1,154 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+
+/* beatroot-context-test: checks that independent trackers in one
+ * process share no state.  A set of jobs, each a BeatRootProcessor
+ * with its own audio and parameters, is run serially twice, then by
+ * many threads at once, each thread running every job in a different
+ * order.  Every run of a job must give exactly the beats of the first
+ * serial run.  Exits with status 1 on any difference.
+ */
+
+#include "BeatRootProcessor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+/** A tracking job: synthetic audio and the parameters to track it */
+struct Job {
+    float sampleRate;
+    std::vector<float> audio;
+    AgentParameters agentParameters;
+    InductionParameters inductionParameters;
+    bool causal;
+};
+
+static unsigned long long seed = 1;
+
+static double random01() {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (seed >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/** Noise bursts at a tempo that drifts from the given one, with
+ *  weaker off-beats and background noise */
+static std::vector<float> synthesise(float rate, double seconds, double bpm)
+{
+    std::vector<float> audio(size_t(rate * seconds));
+    for (size_t i = 0; i < audio.size(); ++i) {
+        audio[i] = 0.01 * (random01() - 0.5);
+    }
+    for (double t = 0.2; t < seconds; t += 60 / bpm) {
+        for (int beat = 0; beat < 2; ++beat) {
+            size_t start = size_t((t + beat * 30 / bpm) * rate);
+            double gain = beat ? 0.3 : 1.0;
+            for (size_t i = start; i < start + 300 && i < audio.size(); ++i) {
+                audio[i] += gain * (random01() - 0.5) * exp(-(i - start) / 60.0);
+            }
+        }
+        bpm *= 1 + 0.01 * (random01() - 0.5);
+    }
+    return audio;
+}
+
+static EventList run(const Job &job)
+{
+    BeatRootProcessor processor(job.sampleRate, job.agentParameters);
+    processor.setInductionParameters(job.inductionParameters);
+    processor.setCausal(job.causal, 0.1);
+    EventList beats;
+    // In blocks, as a host would give them
+    const int block = 4096;
+    for (size_t i = 0; i < job.audio.size(); i += block) {
+        int n = int(std::min(job.audio.size() - i, size_t(block)));
+        processor.processSamples(&job.audio[i], n);
+        if (job.causal) {
+            EventList found = processor.getNewBeats(0);
+            beats.insert(beats.end(), found.begin(), found.end());
+        }
+    }
+    EventList rest = processor.beatTrack(0);
+    beats.insert(beats.end(), rest.begin(), rest.end());
+    return beats;
+}
+
+int main(int argc, char **argv)
+{
+    int threads = (argc > 1) ? atoi(argv[1]) : 8;
+    if (threads < 1) threads = 1;
+
+    std::vector<Job> jobs(8);
+    for (size_t j = 0; j < jobs.size(); ++j) {
+        Job &job = jobs[j];
+        job.sampleRate = (j % 3 == 2) ? 48000 : 44100;
+        job.audio = synthesise(job.sampleRate, 20 + 2 * j, 80 + 15 * j);
+        job.agentParameters.threadCount = (j % 4 == 1) ? 2 : 1;
+        job.agentParameters.maxAgents = (j % 4 == 3) ? 20 : 0;
+        job.inductionParameters.method = (j % 2) ?
+            InductionParameters::Histogram : InductionParameters::Incremental;
+        job.causal = (j % 4 == 2);
+    }
+
+    // Each job twice in turn, so that the second run follows others
+    std::vector<EventList> expected(jobs.size());
+    for (size_t j = 0; j < jobs.size(); ++j) {
+        expected[j] = run(jobs[j]);
+    }
+    int failures = 0;
+    for (size_t j = 0; j < jobs.size(); ++j) {
+        if (run(jobs[j]) != expected[j]) {
+            fprintf(stderr, "job %d: second serial run differs\n", int(j));
+            ++failures;
+        }
+    }
+
+    std::vector<std::vector<EventList> > results(threads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.push_back(std::thread([&jobs, &results, t] {
+            for (size_t k = 0; k < jobs.size(); ++k) {
+                size_t j = (k * 3 + t) % jobs.size();
+                results[t].resize(jobs.size());
+                results[t][j] = run(jobs[j]);
+            }
+        }));
+    }
+    for (int t = 0; t < threads; ++t) {
+        workers[t].join();
+    }
+
+    for (int t = 0; t < threads; ++t) {
+        for (size_t j = 0; j < jobs.size(); ++j) {
+            if (results[t][j] != expected[j]) {
+                fprintf(stderr, "job %d on thread %d: beats differ from "
+                        "the serial run\n", int(j), t);
+                ++failures;
+            }
+        }
+    }
+    if (failures > 0) return 1;
+
+    size_t beats = 0;
+    for (size_t j = 0; j < jobs.size(); ++j) beats += expected[j].size();
+    printf("%d jobs (%d beats) on %d threads: identical to serial runs\n",
+           int(jobs.size()), int(beats), threads);
+    return 0;
+}
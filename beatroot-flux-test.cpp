@@ -0,0 +1,140 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+
+/* beatroot-flux-test: checks every spectral flux kernel compiled into
+ * this build and supported by this processor against the scalar
+ * kernel, which all are designed to match exactly, and the scalar
+ * kernel against the double-precision loop it replaced, within a
+ * tolerance.  The spectra are random, zero, denormal and mixed, with
+ * odd as well as even numbers of bins, over several frames in turn.
+ * Exits with status 1 on any difference.
+ */
+
+#include "SpectralFlux.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+static unsigned long long seed = 1;
+
+static double random01() {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (seed >> 11) * (1.0 / 9007199254740992.0);
+}
+
+enum Content { Random, Zero, Denormal, Mixed, ContentCount };
+
+static const char *contentNames[] = { "random", "zero", "denormal", "mixed" };
+
+static float value(Content content) {
+    double r = random01() * 2 - 1;
+    switch (content) {
+    case Zero: return 0.f;
+    case Denormal: return float(r * FLT_MIN);
+    case Mixed: {
+        int kind = int(random01() * 4);
+        if (kind == 0) return 0.f;
+        if (kind == 1) return float(r * FLT_MIN * 0.5);
+        if (kind == 2) return float(r * 1e4);
+        return float(r);
+    }
+    default: return float(r * 100);
+    }
+}
+
+/** The loop of BeatRootProcessor::processFrame() before the kernels,
+ *  with magnitudes in double precision */
+static double reference(const float *frame, std::vector<double> &prev, int bins,
+                        double &scale)
+{
+    double flux = 0;
+    scale = 0;
+    for (int i = 0; i < bins; i++) {
+        double mag = sqrt(frame[i*2] * frame[i*2] +
+                          frame[i*2+1] * frame[i*2+1]);
+        if (mag > prev[i]) flux += mag - prev[i];
+        scale += mag + prev[i];
+        prev[i] = mag;
+    }
+    return flux;
+}
+
+int main()
+{
+    static const int lengths[] = {
+        1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 63, 65,
+        127, 129, 257, 513, 1025, 2049, 4097
+    };
+    static const SpectralFlux::Kernel kernels[] = {
+        SpectralFlux::Scalar, SpectralFlux::SSE2,
+        SpectralFlux::AVX2, SpectralFlux::NEON
+    };
+    const int frames = 6;
+    int failures = 0, checks = 0;
+
+    for (int k = 0; k < 4; ++k) {
+        SpectralFlux::Kernel kernel = kernels[k];
+        if (!SpectralFlux::isSupported(kernel)) {
+            printf("%s: not supported, skipped\n",
+                   SpectralFlux::getKernelName(kernel));
+            continue;
+        }
+        for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l) {
+            int bins = lengths[l];
+            for (int c = 0; c < ContentCount; ++c) {
+                Content content = Content(c);
+                std::vector<float> prevScalar(bins, 0.f), prevKernel(bins, 0.f);
+                std::vector<double> prevReference(bins, 0.0);
+                for (int f = 0; f < frames; ++f) {
+                    // Every other frame of random content is silent,
+                    // so that magnitudes both rise and fall
+                    Content now = (content == Random && f % 2) ? Zero : content;
+                    std::vector<float> frame(bins * 2);
+                    for (int i = 0; i < bins * 2; ++i) frame[i] = value(now);
+
+                    double expected = SpectralFlux::compute
+                        (SpectralFlux::Scalar, &frame[0], &prevScalar[0], bins);
+                    double actual = SpectralFlux::compute
+                        (kernel, &frame[0], &prevKernel[0], bins);
+                    double scale;
+                    double original = reference(&frame[0], prevReference,
+                                                bins, scale);
+                    ++checks;
+
+                    bool same = (actual == expected) && (prevKernel == prevScalar);
+                    bool close = fabs(expected - original) <=
+                        1e-6 * scale + 1e-30;
+                    if (!same || !close) {
+                        fprintf(stderr, "%s, %d bins, %s, frame %d: flux %.17g, "
+                                "scalar %.17g, original %.17g%s\n",
+                                SpectralFlux::getKernelName(kernel), bins,
+                                contentNames[c], f, actual, expected, original,
+                                same ? "" : " (magnitudes or flux differ)");
+                        ++failures;
+                    }
+                }
+            }
+        }
+        printf("%s: checked\n", SpectralFlux::getKernelName(kernel));
+    }
+    if (failures > 0) return 1;
+    printf("%d frames: all kernels identical to scalar, and scalar within "
+           "tolerance of the original\n", checks);
+    return 0;
+}
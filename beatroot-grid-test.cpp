@@ -0,0 +1,177 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+
+/* beatroot-grid-test: checks that AgentList::removeDuplicates(), which
+ * finds neighbouring agents with an AgentGrid, removes exactly the
+ * agents that the original pairwise scan along the sorted list did,
+ * on random populations with many agents exactly at, and one unit in
+ * the last place either side of, the tempo and phase thresholds.
+ * Exits with status 1 on any difference.
+ */
+
+#include "AgentList.h"
+#include "TrackerContext.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/** Exposes the duplicate removal of AgentList */
+class TestList : public AgentList
+{
+public:
+    TestList(TrackerContext &c) : AgentList(c) { }
+    void removeDuplicates() { AgentList::removeDuplicates(); }
+};
+
+static bool listOrder(const Agent *a, const Agent *b) {
+    if (a->beatInterval == b->beatInterval) {
+        return a->idNumber < b->idNumber;
+    } else {
+        return a->beatInterval < b->beatInterval;
+    }
+}
+
+/** The removal of duplicates as it was before AgentGrid: each agent
+ *  is compared with every later agent in the sorted list whose beat
+ *  interval is within the threshold */
+static void pairwise(std::vector<Agent *> &list)
+{
+    std::sort(list.begin(), list.end(), listOrder);
+    for (size_t i = 0; i < list.size(); ++i) {
+        Agent *agent = list[i];
+        if (agent->phaseScore < 0.0) continue;
+        for (size_t j = i + 1; j < list.size(); ++j) {
+            Agent *other = list[j];
+            if (other->beatInterval - agent->beatInterval > AgentList::DEFAULT_BI)
+                break;
+            if (fabs(agent->beatTime - other->beatTime) > AgentList::DEFAULT_BT)
+                continue;
+            if (agent->phaseScore < other->phaseScore) {
+                agent->phaseScore = -1.0;
+                if (other->topScoreTime < agent->topScoreTime)
+                    other->topScoreTime = agent->topScoreTime;
+                break;
+            } else {
+                other->phaseScore = -1.0;
+                if (agent->topScoreTime < other->topScoreTime)
+                    agent->topScoreTime = other->topScoreTime;
+            }
+        }
+    }
+    std::vector<Agent *> kept;
+    for (size_t i = 0; i < list.size(); ++i) {
+        if (list[i]->phaseScore >= 0.0) kept.push_back(list[i]);
+    }
+    list.swap(kept);
+}
+
+static unsigned long long seed = 1;
+
+static double random01() {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (seed >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int randomInt(int n) {
+    return int(random01() * n);
+}
+
+/** A value at a random distance from base, often exactly at the
+ *  threshold, or one unit in the last place either side of it */
+static double near(double base, double threshold, double spread) {
+    double edge = base + (randomInt(2) ? threshold : -threshold);
+    switch (randomInt(5)) {
+    case 0: return edge;
+    case 1: return nextafter(edge, HUGE_VAL);
+    case 2: return nextafter(edge, -HUGE_VAL);
+    case 3: return base;
+    default: return base + (random01() - 0.5) * spread;
+    }
+}
+
+struct Values {
+    double beatInterval, beatTime, phaseScore, topScoreTime;
+};
+
+int main(int argc, char **argv)
+{
+    int populations = (argc > 1) ? atoi(argv[1]) : 20000;
+    long agents = 0, removed = 0;
+    for (int p = 0; p < populations; ++p) {
+        // A population of random agents, and agents near others
+        int n = 1 + randomInt(p % 10 == 0 ? 400 : 60);
+        std::vector<Values> values(n);
+        for (int i = 0; i < n; ++i) {
+            Values &v = values[i];
+            if (i > 0 && randomInt(3) > 0) {
+                const Values &other = values[randomInt(i)];
+                v.beatInterval = near(other.beatInterval,
+                                      AgentList::DEFAULT_BI, 0.1);
+                v.beatTime = near(other.beatTime,
+                                  AgentList::DEFAULT_BT, 0.2);
+            } else {
+                v.beatInterval = 0.25 + random01() * (p % 2 ? 0.2 : 1.0);
+                v.beatTime = (p % 3 == 0) ? -1.0 : random01() * 10;
+            }
+            // Equal scores are common, and some are already flagged
+            int kind = randomInt(10);
+            v.phaseScore = (kind == 0) ? -1.0 :
+                (kind < 4) ? double(randomInt(4)) : random01() * 20;
+            v.topScoreTime = randomInt(5);
+        }
+
+        // The same agents, with the same identity numbers, for each
+        TrackerContext gridContext, pairContext;
+        TestList list(gridContext);
+        std::vector<Agent *> pairs;
+        for (int i = 0; i < n; ++i) {
+            const Values &v = values[i];
+            Agent *a = Agent::create(gridContext, v.beatInterval);
+            Agent *b = Agent::create(pairContext, v.beatInterval);
+            a->beatTime = b->beatTime = v.beatTime;
+            a->phaseScore = b->phaseScore = v.phaseScore;
+            a->topScoreTime = b->topScoreTime = v.topScoreTime;
+            list.add(a, false);
+            pairs.push_back(b);
+        }
+        list.sort();
+        list.removeDuplicates();
+        pairwise(pairs);
+
+        bool same = (list.size() == pairs.size());
+        for (size_t i = 0; same && i < pairs.size(); ++i) {
+            const Agent *a = *(list.begin() + i), *b = pairs[i];
+            same = (a->idNumber == b->idNumber &&
+                    a->phaseScore == b->phaseScore &&
+                    a->topScoreTime == b->topScoreTime);
+        }
+        if (!same) {
+            fprintf(stderr, "population %d of %d agents: AgentGrid kept %d, "
+                    "pairwise scan kept %d, or kept different agents\n",
+                    p, n, int(list.size()), int(pairs.size()));
+            return 1;
+        }
+        agents += n;
+        removed += n - pairs.size();
+    }
+    printf("%d populations, %ld agents, %ld removed: identical\n",
+           populations, agents, removed);
+    return 0;
+}
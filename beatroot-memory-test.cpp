@@ -0,0 +1,70 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+
+/* beatroot-memory-test: checks the documented memory needed for the
+ * onset detection function in batch mode, 2.88MB per hour of input
+ * (1.44MB in compact mode) at 100 frames per second, by giving a
+ * BeatRootProcessor an hour of frames at each of two sample rates.
+ * The figure may be exceeded only by the part-filled last chunk of
+ * the OnsetFunction and the index of its chunks.  Exits with status 1
+ * if it is not met.
+ */
+
+#include "BeatRootProcessor.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+int main()
+{
+    static const float rates[] = { 44100, 48000 };
+    const double hour = 3600;
+    int failures = 0;
+    for (int r = 0; r < 2; ++r) {
+        for (int compact = 0; compact < 2; ++compact) {
+            BeatRootProcessor processor(rates[r], AgentParameters());
+            processor.setCompact(compact != 0);
+            int bins = processor.getFFTSize() / 2 + 1;
+            std::vector<float> frame(bins * 2, 0.f);
+            const float *buffer = &frame[0];
+            long frames = lrint(hour * rates[r] / processor.getHopSize());
+            for (long i = 0; i < frames; ++i) {
+                frame[2 * (i % bins)] = float(i % 7);
+                processor.processFrame(&buffer);
+            }
+
+            // The documented figure, and what may be added to it
+            size_t valueSize = compact ? sizeof(float) : sizeof(double);
+            double documented = compact ? 1.44e6 : 2.88e6;
+            size_t chunks = (frames + OnsetFunction::CHUNK_SIZE - 1) /
+                OnsetFunction::CHUNK_SIZE;
+            size_t allowance = OnsetFunction::CHUNK_SIZE * valueSize +
+                2 * chunks * sizeof(std::vector<double>);
+            size_t usage = processor.getMemoryUsage();
+            bool ok = (usage >= documented &&
+                       usage <= documented + allowance);
+            printf("%g Hz, %s: %ld frames, %lu bytes (documented %.2fMB, "
+                   "%lu bytes allowed over): %s\n", rates[r],
+                   compact ? "compact" : "full", frames,
+                   (unsigned long)usage, documented / 1e6,
+                   (unsigned long)allowance, ok ? "ok" : "FAILED");
+            if (!ok) ++failures;
+        }
+    }
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,156 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+/* beatroot-pipeline-test: checks that a Pipeline finds exactly the
+ * beats that BeatRootProcessor::processSamples() does, in batch and
+ * causal mode and for lengths of audio ending at every point in a
+ * frame, and that an exception thrown by the source of the audio,
+ * at the start, part way through, or once the queues are full, is
+ * rethrown to the caller of Pipeline::run() rather than ending the
+ * process.  Exits with status 1 on any difference or failure.
+ */
+
+#include "Pipeline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+static unsigned long long seed = 1;
+
+static double random01() {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (seed >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/** Noise bursts at a steady tempo, over background noise */
+static std::vector<float> synthesise(float rate, double seconds, double bpm)
+{
+    std::vector<float> audio(size_t(rate * seconds));
+    for (size_t i = 0; i < audio.size(); ++i) {
+        audio[i] = float(0.01 * (random01() - 0.5));
+    }
+    for (double t = 0.2; t < seconds; t += 60 / bpm) {
+        size_t start = size_t(t * rate);
+        for (size_t i = start; i < start + 300 && i < audio.size(); ++i) {
+            audio[i] += float((random01() - 0.5) * exp(-(i - start) / 60.0));
+        }
+    }
+    return audio;
+}
+
+/** Gives the audio in blocks of varying size, and if failAt is not
+ *  negative, throws once that many samples have been read */
+class TestSource : public Pipeline::Source
+{
+public:
+    TestSource(const std::vector<float> &a, size_t length, long f) :
+        audio(a), end(length), failAt(f), position(0) { }
+
+    size_t read(float *mono, size_t n) {
+        if (failAt >= 0 && position >= size_t(failAt)) {
+            throw std::runtime_error("source failed");
+        }
+        n = std::min(n, size_t(1 + position % 3000));
+        if (n > end - position) n = end - position;
+        for (size_t i = 0; i < n; ++i) mono[i] = audio[position + i];
+        position += n;
+        return n;
+    }
+
+protected:
+    const std::vector<float> &audio;
+    size_t end;
+    long failAt;
+    size_t position;
+};
+
+static bool same(const EventList &a, const EventList &b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].time != b[i].time) return false;
+    }
+    return true;
+}
+
+int main()
+{
+    const float rate = 44100;
+    std::vector<float> audio = synthesise(rate, 15, 123);
+    AgentParameters params;
+    int checked = 0;
+
+    for (int causal = 0; causal < 2; ++causal) {
+        // Lengths ending at different points in the last frame
+        for (int extra = 0; extra < 2048; extra += 331) {
+            size_t length = size_t(10 * rate) + extra;
+
+            BeatRootProcessor direct(rate, params);
+            direct.setCausal(causal, 0.1);
+            // A hop at a time, so that in causal mode the beats are
+            // taken after every frame, as the pipeline takes them
+            EventList expected;
+            int hop = direct.getHopSize();
+            for (size_t i = 0; i < length; i += hop) {
+                int n = int(std::min(length - i, size_t(hop)));
+                direct.processSamples(&audio[i], n);
+                EventList found = direct.getNewBeats(0);
+                expected.insert(expected.end(), found.begin(), found.end());
+            }
+            EventList rest = direct.beatTrack(0);
+            expected.insert(expected.end(), rest.begin(), rest.end());
+
+            BeatRootProcessor staged(rate, params);
+            staged.setCausal(causal, 0.1);
+            TestSource source(audio, length, -1);
+            EventList beats = Pipeline(staged).run(source, 0);
+            if (!same(beats, expected)) {
+                fprintf(stderr, "%s, %d samples: pipeline found %d "
+                        "beats, processSamples() %d, or different ones\n",
+                        causal ? "causal" : "batch", int(length),
+                        int(beats.size()), int(expected.size()));
+                return 1;
+            }
+            ++checked;
+        }
+
+        // Failures at the start, part way, and after the audio queue
+        // could have filled
+        long failures[] = { 0, 5000, long(Pipeline::AUDIO_QUEUE_SIZE) * 4 };
+        for (int f = 0; f < 3; ++f) {
+            BeatRootProcessor staged(rate, params);
+            staged.setCausal(causal, 0.1);
+            TestSource source(audio, audio.size(), failures[f]);
+            bool caught = false;
+            try {
+                Pipeline(staged).run(source, 0);
+            } catch (const std::runtime_error &e) {
+                caught = true;
+            }
+            if (!caught) {
+                fprintf(stderr, "%s: failure of the source after %ld "
+                        "samples was not reported\n",
+                        causal ? "causal" : "batch", failures[f]);
+                return 1;
+            }
+            ++checked;
+        }
+    }
+    printf("%d runs: identical beats, and every failure reported\n", checked);
+    return 0;
+}
@@ -0,0 +1,145 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+/* beatroot-prune-test: checks that AgentList::prune(), which selects
+ * the Agents to keep within each tempo group, keeps exactly the
+ * agents that the original sort by group and rank did, on random
+ * populations with few and many groups, groups of one agent, and
+ * many equal scores.  Exits with status 1 on any difference.
+ */
+
+#include "AgentList.h"
+#include "TrackerContext.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+/** Exposes the pruning of AgentList */
+class TestList : public AgentList
+{
+public:
+    TestList(TrackerContext &c) : AgentList(c) { }
+    void prune(int maxAgents) { AgentList::prune(maxAgents); }
+};
+
+typedef std::pair<int, Agent *> Ranked;
+
+static bool groupOrder(const Ranked &a, const Ranked &b) {
+    const Agent *x = a.second, *y = b.second;
+    if (x->initialBeatInterval != y->initialBeatInterval)
+        return x->initialBeatInterval < y->initialBeatInterval;
+    if (x->phaseScore != y->phaseScore)
+        return x->phaseScore > y->phaseScore;
+    return x->idNumber < y->idNumber;
+}
+
+static bool rankOrder(const Ranked &a, const Ranked &b) {
+    if (a.first != b.first)
+        return a.first < b.first;
+    if (a.second->phaseScore != b.second->phaseScore)
+        return a.second->phaseScore > b.second->phaseScore;
+    return a.second->idNumber < b.second->idNumber;
+}
+
+/** The pruning as it was before selection within the groups: all the
+ *  agents are sorted by group and score to find their ranks, and the
+ *  best maxAgents by rank are kept, in the order of the list */
+static void sorted(std::vector<Agent *> &list, int maxAgents)
+{
+    std::vector<Ranked> ranked;
+    for (size_t i = 0; i < list.size(); ++i) {
+        ranked.push_back(std::make_pair(0, list[i]));
+    }
+    std::sort(ranked.begin(), ranked.end(), groupOrder);
+    for (size_t i = 1; i < ranked.size(); ++i) {
+        if (ranked[i].second->initialBeatInterval ==
+            ranked[i-1].second->initialBeatInterval)
+            ranked[i].first = ranked[i-1].first + 1;
+    }
+    std::nth_element(ranked.begin(), ranked.begin() + maxAgents,
+                     ranked.end(), rankOrder);
+    for (size_t i = maxAgents; i < ranked.size(); ++i) {
+        ranked[i].second->phaseScore = -1.0;
+    }
+    std::vector<Agent *> kept;
+    for (size_t i = 0; i < list.size(); ++i) {
+        if (list[i]->phaseScore >= 0.0) kept.push_back(list[i]);
+    }
+    list.swap(kept);
+}
+
+static unsigned long long seed = 1;
+
+static double random01() {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (seed >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int randomInt(int n) {
+    return int(random01() * n);
+}
+
+int main(int argc, char **argv)
+{
+    int populations = (argc > 1) ? atoi(argv[1]) : 20000;
+    long agents = 0, removed = 0;
+    for (int p = 0; p < populations; ++p) {
+        int n = 2 + randomInt(p % 10 == 0 ? 400 : 60);
+        int groupCount = 1 + randomInt(p % 3 == 0 ? n : 8);
+        int maxAgents = 1 + randomInt(n - 1);
+
+        // The same agents, with the same identity numbers, for each
+        TrackerContext selectContext, sortContext;
+        TestList list(selectContext);
+        std::vector<Agent *> reference;
+        for (int i = 0; i < n; ++i) {
+            double ibi = 0.3 + 0.01 * randomInt(groupCount);
+            // Equal scores are common
+            double score = randomInt(2) ? double(randomInt(4))
+                                        : random01() * 20;
+            Agent *a = Agent::create(selectContext, ibi);
+            Agent *b = Agent::create(sortContext, ibi);
+            a->beatInterval = b->beatInterval = ibi + 0.01 * random01();
+            a->phaseScore = b->phaseScore = score;
+            list.add(a, false);
+            reference.push_back(b);
+        }
+        list.prune(maxAgents);
+        sorted(reference, maxAgents);
+
+        bool same = (list.size() == reference.size());
+        for (size_t i = 0; same && i < reference.size(); ++i) {
+            const Agent *a = *(list.begin() + i), *b = reference[i];
+            same = (a->idNumber == b->idNumber &&
+                    a->phaseScore == b->phaseScore);
+        }
+        if (!same) {
+            fprintf(stderr, "population %d of %d agents in %d groups, "
+                    "cap %d: selection kept %d, sort kept %d, or kept "
+                    "different agents\n", p, n, groupCount, maxAgents,
+                    int(list.size()), int(reference.size()));
+            return 1;
+        }
+        agents += n;
+        removed += n - reference.size();
+    }
+    printf("%d populations, %ld agents, %ld removed: identical\n",
+           populations, agents, removed);
+    return 0;
+}
@@ -0,0 +1,141 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+/* beatroot-reframe-test: checks that a Reframer given time-domain
+ * blocks of other sizes and steps than the processor's own frames
+ * finds exactly the beats found at the preferred block and step,
+ * where the frames are passed on unchanged, in batch mode (and in
+ * causal mode, whose beats are reported at each step, for other
+ * blocks at the preferred step) and for lengths of audio which are multiples of every step, so that
+ * the host's last step ends at the same point whatever its size.
+ * Exits with status 1 on any difference.
+ */
+
+#include "BeatRootProcessor.h"
+#include "Reframer.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+static unsigned long long seed = 1;
+
+static double random01() {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (seed >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/** Noise bursts at a steady tempo, over background noise */
+static std::vector<float> synthesise(float rate, double seconds, double bpm)
+{
+    std::vector<float> audio(size_t(rate * seconds));
+    for (size_t i = 0; i < audio.size(); ++i) {
+        audio[i] = float(0.01 * (random01() - 0.5));
+    }
+    for (double t = 0.2; t < seconds; t += 60 / bpm) {
+        size_t start = size_t(t * rate);
+        for (size_t i = start; i < start + 300 && i < audio.size(); ++i) {
+            audio[i] += float((random01() - 0.5) * exp(-(i - start) / 60.0));
+        }
+    }
+    return audio;
+}
+
+/** Tracks the beats of the first length samples of audio given as a
+ *  Vamp host would give them: in blocks of blockSize samples every
+ *  stepSize samples, for as long as a block starts within the audio,
+ *  with the last zero-padded.  In causal mode the beats are taken
+ *  after every block. */
+static EventList track(const std::vector<float> &audio, size_t length,
+                       float rate, bool causal, int stepSize, int blockSize,
+                       bool &direct)
+{
+    BeatRootProcessor processor(rate, AgentParameters());
+    processor.setCausal(causal, 0.1);
+    Reframer reframer(&processor, true, stepSize, blockSize);
+    direct = reframer.isDirect();
+    std::vector<float> block(blockSize);
+    EventList beats;
+    for (size_t start = 0; start < length; start += stepSize) {
+        for (int i = 0; i < blockSize; ++i) {
+            block[i] = (start + i < length) ? audio[start + i] : 0.f;
+        }
+        reframer.process(&block[0]);
+        EventList found = processor.getNewBeats(0);
+        beats.insert(beats.end(), found.begin(), found.end());
+    }
+    EventList rest = processor.beatTrack(0);
+    beats.insert(beats.end(), rest.begin(), rest.end());
+    return beats;
+}
+
+static bool same(const EventList &a, const EventList &b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].time != b[i].time) return false;
+    }
+    return true;
+}
+
+int main()
+{
+    const float rate = 44100;
+    std::vector<float> audio = synthesise(rate, 15, 117);
+    BeatRootProcessor defaults(rate, AgentParameters());
+    int hop = defaults.getHopSize(), fftSize = defaults.getFFTSize();
+    // Other blocks and steps: shorter and longer blocks at the
+    // preferred step, and steps of several hops, with blocks from
+    // the step itself to longer than the preferred block
+    const int others[][2] = {
+        { 1, fftSize / 2 }, { 1, fftSize * 2 }, { 2, fftSize },
+        { 2, hop * 2 }, { 3, fftSize * 2 }, { 6, 4096 },
+    };
+    int checked = 0;
+
+    for (int causal = 0; causal < 2; ++causal) {
+        for (int j = 0; j < 3; ++j) {
+            size_t length = (size_t(10 * rate) / (6 * hop) + j) * 6 * hop;
+            bool direct = false;
+            EventList expected = track(audio, length, rate, causal,
+                                       hop, fftSize, direct);
+            if (!direct || expected.empty()) {
+                fprintf(stderr, "preferred block and step: %s\n", direct ?
+                        "no beats found" : "frames not passed on directly");
+                return 1;
+            }
+            for (size_t k = 0; k < sizeof(others) / sizeof(others[0]); ++k) {
+                int step = others[k][0] * hop, block = others[k][1];
+                // Causal beats are reported once per step, and a beat
+                // predicted in time at one step may be found too late
+                // at another, so only the block is varied
+                if (causal && step != hop) continue;
+                EventList beats = track(audio, length, rate, causal,
+                                        step, block, direct);
+                if (!same(beats, expected)) {
+                    fprintf(stderr, "%s, %d samples, step %d, block %d: "
+                            "%d beats, %d at the preferred step and block, "
+                            "or different ones\n",
+                            causal ? "causal" : "batch", int(length), step,
+                            block, int(beats.size()), int(expected.size()));
+                    return 1;
+                }
+                ++checked;
+            }
+        }
+    }
+    printf("%d runs: identical beats\n", checked);
+    return 0;
+}
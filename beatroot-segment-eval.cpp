@@ -0,0 +1,215 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+/* beatroot-segment-eval: compares segmented beat tracking (see
+ * SegmentedBeatTracker) with whole-input tracking, on synthetic click
+ * tracks whose tempo varies in known ways.
+ */
+
+#include "BeatRootProcessor.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+using std::string;
+
+/** A click track: its tempo in beats per minute as a function of time */
+struct TempoCurve {
+    const char *name;
+    double (*bpm)(double t, double duration);
+};
+
+static double constant(double, double) { return 120; }
+static double ramp(double t, double d) { return 90 + 60 * t / d; }
+static double steps(double t, double) {
+    static const double tempi[] = { 100, 128, 140, 85 };
+    return tempi[int(t / 120) % 4];
+}
+static double drift(double t, double) { return 110 * (1 + 0.08 * sin(2 * M_PI * t / 90)); }
+static double mix(double t, double) {
+    // DJ-style: a tempo for each track, with a gradual change between
+    static const double tempi[] = { 124, 128, 126, 132, 122 };
+    int i = int(t / 180), n = 5;
+    double within = t - i * 180;
+    double a = tempi[i % n], b = tempi[(i + 1) % n];
+    if (within < 150) return a;
+    return a + (b - a) * (within - 150) / 30;
+}
+
+static const TempoCurve curves[] = {
+    { "constant 120", constant },
+    { "ramp 90-150", ramp },
+    { "steps", steps },
+    { "drift +/-8%", drift },
+    { "dj mix", mix },
+};
+
+static unsigned int seed = 1;
+
+static double noise()
+{
+    seed = seed * 1103515245u + 12345u;
+    return ((seed >> 8) & 0xffffff) / double(0x1000000) - 0.5;
+}
+
+/** Synthesises a click track, returning its beat times */
+static vector<double> synthesise(const TempoCurve &curve, double duration,
+                                 float rate, vector<float> &audio)
+{
+    vector<double> beats;
+    audio.assign(size_t(duration * rate), 0.f);
+    double t = 0.5;
+    int n = 0;
+    while (t < duration) {
+        beats.push_back(t);
+        double ibi = 60 / curve.bpm(t, duration);
+        // An accented click on each beat, and a quieter one between
+        double level = (n % 4 == 0) ? 1.0 : 0.6;
+        for (int c = 0; c < 2; ++c) {
+            size_t start = size_t((t + c * ibi / 2) * rate);
+            int length = int(0.01 * rate);
+            for (int i = 0; i < length && start + i < audio.size(); ++i) {
+                audio[start + i] += float(level * noise() * exp(-i / (0.002 * rate)));
+            }
+            level *= 0.3;
+        }
+        t += ibi;
+        ++n;
+    }
+    for (size_t i = 0; i < audio.size(); ++i) audio[i] += float(0.01 * noise());
+    return beats;
+}
+
+/** @return The F-measure of the beats against the reference, with a
+ *  tolerance of 70ms */
+static double fMeasure(const vector<double> &beats, const vector<double> &reference)
+{
+    if (beats.empty() || reference.empty()) return 0;
+    size_t matched = 0, j = 0;
+    for (size_t i = 0; i < beats.size(); ++i) {
+        while (j < reference.size() && reference[j] < beats[i] - 0.07) ++j;
+        if (j < reference.size() && fabs(reference[j] - beats[i]) <= 0.07) {
+            ++matched;
+            ++j;
+        }
+    }
+    double precision = double(matched) / beats.size();
+    double recall = double(matched) / reference.size();
+    if (matched == 0) return 0;
+    return 2 * precision * recall / (precision + recall);
+}
+
+/** Tracks the beats of the audio, returning the time taken to track
+ *  them once the onset detection function has been calculated */
+static double track(const vector<float> &audio, float rate, int threads,
+                    double segmentLength, double overlap,
+                    vector<double> &beats)
+{
+    AgentParameters params;
+    params.threadCount = threads;
+    BeatRootProcessor proc(rate, params);
+    proc.setSegmented(segmentLength, overlap);
+    proc.processSamples(&audio[0], int(audio.size()));
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    EventList el = proc.beatTrack(0);
+    double elapsed = std::chrono::duration<double>
+        (std::chrono::steady_clock::now() - start).count();
+    double offset = (proc.getFFTSize() / 2) / double(rate);
+    beats.clear();
+    for (EventList::const_iterator i = el.begin(); i != el.end(); ++i) {
+        beats.push_back(i->time + offset);
+    }
+    return elapsed;
+}
+
+static void usage(const char *name)
+{
+    std::cerr <<
+        "Usage: " << name << " [-d SECONDS] [-g SECONDS] [-o SECONDS] [-j N]\n"
+        "\n"
+        "Compares segmented with whole-input beat tracking on synthetic click\n"
+        "tracks with varying tempo, reporting the F-measure (70ms tolerance) of\n"
+        "each against the true beats and of the segmented against the whole-\n"
+        "input beats, and the time taken to track them.\n"
+        "\n"
+        "  -d SECONDS  Length of each click track (default 600)\n"
+        "  -g SECONDS  Segment length (default "
+              << SegmentedBeatTracker::DEFAULT_SEGMENT_LENGTH << ")\n"
+        "  -o SECONDS  Segment overlap (default "
+              << SegmentedBeatTracker::DEFAULT_OVERLAP << ")\n"
+        "  -j N        Threads for segmented tracking (default: one per core)\n";
+}
+
+int main(int argc, char **argv)
+{
+    double duration = 600;
+    double segmentLength = SegmentedBeatTracker::DEFAULT_SEGMENT_LENGTH;
+    double overlap = SegmentedBeatTracker::DEFAULT_OVERLAP;
+    int threads = std::thread::hardware_concurrency();
+    if (threads < 1) threads = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        double value = atof(argv[++i]);
+        if (arg == "-d") duration = value;
+        else if (arg == "-g") segmentLength = value;
+        else if (arg == "-o") overlap = value;
+        else if (arg == "-j") threads = int(value);
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!(duration > 0) || !(segmentLength > 0) || overlap < 0 || threads < 1) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    const float rate = 44100;
+    printf("%-14s %8s %8s %8s %9s %9s\n", "track", "F whole", "F seg",
+           "F agree", "t whole", "t seg");
+    double sums[3] = { 0, 0, 0 };
+    int n = sizeof(curves) / sizeof(curves[0]);
+    for (int c = 0; c < n; ++c) {
+        vector<float> audio;
+        vector<double> truth = synthesise(curves[c], duration, rate, audio);
+        vector<double> whole, segmented;
+        double tw = track(audio, rate, 1, 0, 0, whole);
+        double ts = track(audio, rate, threads, segmentLength, overlap, segmented);
+        double f[3] = { fMeasure(whole, truth), fMeasure(segmented, truth),
+                        fMeasure(segmented, whole) };
+        for (int k = 0; k < 3; ++k) sums[k] += f[k];
+        printf("%-14s %8.3f %8.3f %8.3f %8.2fs %8.2fs\n", curves[c].name,
+               f[0], f[1], f[2], tw, ts);
+    }
+    printf("%-14s %8.3f %8.3f %8.3f\n", "mean",
+           sums[0] / n, sums[1] / n, sums[2] / n);
+    return 0;
+}
@@ -0,0 +1,283 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+#include "beatroot.h"
+#include "BeatRootProcessor.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <new>
+
+struct beatroot_workspace
+{
+    beatroot_workspace() : processor(0) { }
+    ~beatroot_workspace() { delete processor; }
+
+    /** The processor for the sample rate of the latest audio */
+    BeatRootProcessor *processor;
+};
+
+struct beatroot_cancel_token
+{
+    beatroot_cancel_token() : cancelled(false) { }
+
+    std::atomic<bool> cancelled;
+};
+
+void beatroot_params_init(beatroot_params *params)
+{
+    if (!params) return;
+    memset(params, 0, sizeof(beatroot_params));
+    params->size = sizeof(beatroot_params);
+    params->pre_margin_factor = AgentParameters::DEFAULT_PRE_MARGIN_FACTOR;
+    params->post_margin_factor = AgentParameters::DEFAULT_POST_MARGIN_FACTOR;
+    params->max_change = AgentParameters::DEFAULT_MAX_CHANGE;
+    params->expiry_time = AgentParameters::DEFAULT_EXPIRY_TIME;
+    params->thread_count = AgentParameters::DEFAULT_THREAD_COUNT;
+    params->decay_factor = AgentParameters::DEFAULT_DECAY_FACTOR;
+    params->causal = 0;
+    params->lookahead = CausalBeatTracker::DEFAULT_LOOKAHEAD;
+    params->compact = 0;
+    params->max_agents = AgentParameters::DEFAULT_MAX_AGENTS;
+    params->prune_dominated = AgentParameters::DEFAULT_PRUNE_DOMINATED;
+    params->time_limit = 0;
+    params->cancel = 0;
+}
+
+beatroot_workspace *beatroot_workspace_create(void)
+{
+    return new (std::nothrow) beatroot_workspace;
+}
+
+void beatroot_workspace_destroy(beatroot_workspace *workspace)
+{
+    delete workspace;
+}
+
+beatroot_cancel_token *beatroot_cancel_token_create(void)
+{
+    return new (std::nothrow) beatroot_cancel_token;
+}
+
+void beatroot_cancel_token_destroy(beatroot_cancel_token *token)
+{
+    delete token;
+}
+
+void beatroot_cancel(beatroot_cancel_token *token)
+{
+    if (token) token->cancelled = true;
+}
+
+/** Prepares the workspace's processor for new audio at the given
+ *  rate, with the caller's parameters, whose time limit starts now.
+ *  Throws std::bad_alloc. */
+static BeatRootProcessor *prepare(beatroot_workspace *workspace,
+                                  float sample_rate,
+                                  const beatroot_params &p)
+{
+    AgentParameters ap;
+    ap.preMarginFactor = p.pre_margin_factor;
+    ap.postMarginFactor = p.post_margin_factor;
+    ap.maxChange = p.max_change;
+    ap.expiryTime = p.expiry_time;
+    ap.threadCount = p.thread_count;
+    ap.decayFactor = p.decay_factor;
+    ap.maxAgents = p.max_agents;
+    ap.pruneDominated = (p.prune_dominated != 0);
+
+    BeatRootProcessor *proc = workspace->processor;
+    if (!proc || proc->getSampleRate() != sample_rate) {
+        delete proc;
+        workspace->processor = 0;
+        proc = new BeatRootProcessor(sample_rate, ap);
+        workspace->processor = proc;
+    } else {
+        proc->reset();
+        proc->setParameters(ap);
+    }
+    proc->setCausal(p.causal != 0, p.lookahead);
+    proc->setCompact(p.compact != 0);
+    Deadline deadline;
+    if (p.time_limit > 0) deadline = Deadline::after(p.time_limit);
+    if (p.cancel) deadline.setCancelFlag(&p.cancel->cancelled);
+    proc->setDeadline(deadline);
+    return proc;
+}
+
+/** Gives the audio to the processor.  Whole frames are read from the
+ *  caller's buffer; only the zero-padded frames at the end are
+ *  copied. */
+static void process(BeatRootProcessor *proc, const float *pcm, size_t frames)
+{
+    size_t fftSize = proc->getFFTSize(), hopSize = proc->getHopSize();
+    size_t start = 0;
+    for ( ; start + fftSize <= frames; start += hopSize) {
+        proc->processTimeDomainFrame(pcm + start);
+    }
+    if (start < frames) {
+        proc->processSamples(pcm + start, int(frames - start));
+    }
+}
+
+/** @return Whether x is a finite number no less than zero */
+static bool nonNegative(double x)
+{
+    return std::isfinite(x) && x >= 0;
+}
+
+/** Takes those fields of the caller's parameters that it knows
+ *  about, or the defaults if there are none.
+ *  @return false if the parameters are invalid */
+static bool readParams(const beatroot_params *userParams, beatroot_params &p)
+{
+    beatroot_params_init(&p);
+    if (userParams) {
+        if (userParams->size < sizeof(size_t)) {
+            return false;
+        }
+        size_t n = userParams->size;
+        if (n > sizeof(beatroot_params)) n = sizeof(beatroot_params);
+        memcpy(&p, userParams, n);
+    }
+    if (p.thread_count < 1 || p.thread_count > BEATROOT_MAX_THREADS) {
+        return false;
+    }
+    return nonNegative(p.pre_margin_factor) &&
+        nonNegative(p.post_margin_factor) &&
+        nonNegative(p.max_change) &&
+        nonNegative(p.expiry_time) &&
+        nonNegative(p.decay_factor) &&
+        nonNegative(p.lookahead);
+}
+
+ptrdiff_t beatroot_track(beatroot_workspace *workspace,
+                         const float *pcm, size_t frames,
+                         float sample_rate,
+                         const beatroot_params *userParams,
+                         double *beats, size_t capacity)
+{
+    beatroot_params p;
+    if (!workspace || (!pcm && frames > 0) || !(sample_rate > 0) ||
+        (!beats && capacity > 0) || !readParams(userParams, p)) {
+        return BEATROOT_ERROR_INVALID_ARGUMENT;
+    }
+
+    try {
+        BeatRootProcessor *proc = prepare(workspace, sample_rate, p);
+        process(proc, pcm, frames);
+
+        EventList el = proc->beatTrack(0);
+
+        // Frame times are those of their centres
+        double offset = (proc->getFFTSize() / 2) / double(sample_rate);
+        size_t count = 0;
+        for (EventList::const_iterator i = el.begin(); i != el.end(); ++i) {
+            if (count < capacity) beats[count] = i->time + offset;
+            ++count;
+        }
+        return ptrdiff_t(count);
+
+    } catch (const std::bad_alloc &) {
+        return BEATROOT_ERROR_OUT_OF_MEMORY;
+    } catch (...) {
+        // Nothing may be thrown across the C interface
+        return BEATROOT_ERROR_INTERNAL;
+    }
+}
+
+ptrdiff_t beatroot_estimate_tempo(beatroot_workspace *workspace,
+                                  const float *pcm, size_t frames,
+                                  float sample_rate,
+                                  const beatroot_params *userParams,
+                                  double max_seconds,
+                                  double *tempi, int *scores,
+                                  size_t capacity)
+{
+    beatroot_params p;
+    if (!workspace || (!pcm && frames > 0) || !(sample_rate > 0) ||
+        (!tempi && capacity > 0) || !readParams(userParams, p)) {
+        return BEATROOT_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (max_seconds > 0 && max_seconds * sample_rate < frames) {
+        frames = size_t(max_seconds * sample_rate);
+    }
+
+    try {
+        // Induction needs the whole of the onset detection function
+        p.causal = 0;
+        BeatRootProcessor *proc = prepare(workspace, sample_rate, p);
+        process(proc, pcm, frames);
+
+        vector<TempoHypothesis> hypotheses = proc->estimateTempo();
+        for (size_t i = 0; i < hypotheses.size() && i < capacity; ++i) {
+            tempi[i] = 60.0 / hypotheses[i].beatInterval;
+            if (scores) scores[i] = hypotheses[i].score;
+        }
+        return ptrdiff_t(hypotheses.size());
+
+    } catch (const std::bad_alloc &) {
+        return BEATROOT_ERROR_OUT_OF_MEMORY;
+    } catch (...) {
+        // Nothing may be thrown across the C interface
+        return BEATROOT_ERROR_INTERNAL;
+    }
+}
+
+int beatroot_is_partial(const beatroot_workspace *workspace)
+{
+    if (!workspace || !workspace->processor) return 0;
+    return workspace->processor->isPartial() ? 1 : 0;
+}
+
+int beatroot_get_stats(const beatroot_workspace *workspace,
+                       beatroot_stats *userStats)
+{
+    if (!workspace || !userStats || userStats->size < sizeof(size_t)) {
+        return BEATROOT_ERROR_INVALID_ARGUMENT;
+    }
+
+    beatroot_stats s;
+    memset(&s, 0, sizeof(beatroot_stats));
+    s.size = userStats->size;
+    s.enabled = TrackingStats::isEnabled();
+    if (workspace->processor) {
+        const TrackingStats &t = workspace->processor->getStats();
+        s.induced_agents = t.inducedAgents;
+        s.forks = t.forks;
+        s.expired = t.expired;
+        s.duplicates = t.duplicates;
+        s.onsets = t.onsets;
+        s.peak_agents = t.peakAgents;
+        s.mean_agents = t.getMeanAgents();
+        s.considered_per_onset = t.getConsideredPerOnset();
+        s.frame_time = t.frameTime;
+        s.onset_time = t.onsetTime;
+        s.induction_time = t.inductionTime;
+        s.tracking_time = t.trackingTime;
+        s.fill_time = t.fillTime;
+        s.pruned = t.pruned;
+        s.dominated = t.dominated;
+    }
+
+    // Only the fields the caller knows about are written
+    size_t n = userStats->size;
+    if (n > sizeof(beatroot_stats)) n = sizeof(beatroot_stats);
+    memcpy(userStats, &s, n);
+    return 0;
+}
@@ -0,0 +1,270 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+  Vamp feature extraction plugin for the BeatRoot beat tracker.
+
+  Centre for Digital Music, Queen Mary, University of London.
+  This file copyright 2011 Simon Dixon, Chris Cannam and QMUL.
+    
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2 of the
+  License, or (at your option) any later version.  See the file
+  COPYING included with this distribution for more information.
+*/
+
+
+#ifndef _BEATROOT_H_
+#define _BEATROOT_H_
+
+/* C interface to the BeatRoot beat tracker, for use without a Vamp
+ * host and from languages other than C++.
+ *
+ * Typical use:
+ *
+ *   beatroot_params params;
+ *   beatroot_params_init(&params);
+ *   params.max_change = 0.3;
+ *   beatroot_workspace *ws = beatroot_workspace_create();
+ *   ptrdiff_t n = beatroot_track(ws, pcm, frames, 44100.f, &params,
+ *                                beats, capacity);
+ *   ...
+ *   beatroot_workspace_destroy(ws);
+ *
+ * Fields may be added to the end of beatroot_params in later
+ * versions.  Its size field tells the library which fields the caller
+ * knows about, so that a program built against an older header keeps
+ * working with a newer library.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BEATROOT_API_VERSION 6
+
+/* Error codes returned by beatroot_track(),
+ * beatroot_estimate_tempo() and beatroot_get_stats().
+ * INVALID_ARGUMENT includes parameters out of range: a thread_count
+ * outside 1 to BEATROOT_MAX_THREADS, or a margin factor, max_change,
+ * expiry_time, decay_factor or lookahead which is negative or not
+ * finite.  INTERNAL is any other failure, such as being unable to
+ * start a thread. */
+#define BEATROOT_ERROR_INVALID_ARGUMENT (-1)
+#define BEATROOT_ERROR_OUT_OF_MEMORY    (-2)
+#define BEATROOT_ERROR_INTERNAL         (-3)
+
+/* The largest thread_count accepted in beatroot_params, which is also
+ * the largest "threads" parameter of the Vamp plugin */
+#define BEATROOT_MAX_THREADS 256
+
+/* A flag by which beatroot_track() may be cancelled from another
+ * thread (see beatroot_params). */
+typedef struct beatroot_cancel_token beatroot_cancel_token;
+
+typedef struct beatroot_params
+{
+    /* sizeof(beatroot_params), as set by beatroot_params_init() */
+    size_t size;
+
+    /* The maximum amount by which a beat can be earlier than the
+     * predicted beat time, expressed as a fraction of the beat
+     * period. */
+    double pre_margin_factor;
+
+    /* The maximum amount by which a beat can be later than the
+     * predicted beat time, expressed as a fraction of the beat
+     * period. */
+    double post_margin_factor;
+
+    /* The maximum allowed deviation from the initial tempo, expressed
+     * as a fraction of the initial beat period. */
+    double max_change;
+
+    /* The time (in seconds) after which a tempo hypothesis with no
+     * onset matching its beat predictions is abandoned. */
+    double expiry_time;
+
+    /* The number of threads used to test onsets against the beat
+     * predictions, from 1 to BEATROOT_MAX_THREADS; the beats found do
+     * not depend on it. */
+    int thread_count;
+
+    /* If greater than zero, the number of recent beats over which the
+     * score of each hypothesis is averaged rather than summed.  Zero
+     * (the default) sums the scores in batch tracking, and averages
+     * them over the last 400 or so beats in causal tracking, so that
+     * the beats can follow changes in the music. */
+    double decay_factor;
+
+    /* Non-zero to track beats causally, as they would be found in
+     * real time with the given lookahead (in seconds). */
+    int causal;
+    double lookahead;
+
+    /* Non-zero to store the onset detection function in single
+     * rather than double precision, halving the memory needed for
+     * long input (2.88MB per hour of audio otherwise), at the cost
+     * of occasional small differences in the beats found. */
+    int compact;
+
+    /* If greater than zero, the largest number of tempo and phase
+     * hypotheses kept at once; the lowest-scoring hypotheses at each
+     * tempo are abandoned beyond it.  This bounds the time taken on
+     * noisy input, at some risk to the beats found. */
+    int max_agents;
+
+    /* Non-zero to abandon the hypotheses whose score could no longer
+     * overtake the best one's, even with every onset still to come.
+     * This changes the beats found only if the best hypothesis later
+     * finds no beat for expiry_time seconds.  It has no effect in
+     * causal tracking or with a decay_factor. */
+    int prune_dominated;
+
+    /* If greater than zero, the time in seconds from the start of
+     * beatroot_track() after which beat tracking stops, returning the
+     * beats found until then (see beatroot_is_partial()).  It is
+     * checked between onsets, and not applied in causal tracking. */
+    double time_limit;
+
+    /* If not NULL, a token whose cancellation by beatroot_cancel()
+     * stops beat tracking in the same way. */
+    beatroot_cancel_token *cancel;
+
+} beatroot_params;
+
+/* Counters of the work done by the latest call of beatroot_track()
+ * or beatroot_estimate_tempo() with a workspace, for finding out why
+ * some input takes much longer than usual.  They are counted only if
+ * the library is built with BEATROOT_ENABLE_STATS; otherwise enabled
+ * is zero, and so are all the counters.  As with beatroot_params,
+ * fields may be added to the end in later versions. */
+typedef struct beatroot_stats
+{
+    /* sizeof(beatroot_stats), to be set by the caller */
+    size_t size;
+
+    /* Non-zero if the counters are updated in this build */
+    int enabled;
+
+    /* The number of tempo hypotheses created by tempo induction, of
+     * hypotheses created by forking, of those abandoned for having no
+     * onset matching their predictions, and of those removed as
+     * duplicates of others */
+    long induced_agents;
+    long forks;
+    long expired;
+    long duplicates;
+
+    /* The number of onsets offered to the hypotheses, the largest and
+     * mean number of hypotheses to which an onset was offered, and
+     * the mean number that considered each as a possible beat */
+    long onsets;
+    long peak_agents;
+    double mean_agents;
+    double considered_per_onset;
+
+    /* The time in seconds taken to calculate the onset detection
+     * function, to find the onsets, by tempo induction, to track
+     * beats, and to interpolate missing beats */
+    double frame_time;
+    double onset_time;
+    double induction_time;
+    double tracking_time;
+    double fill_time;
+
+    /* The number of hypotheses removed to keep to max_agents */
+    long pruned;
+
+    /* The number of hypotheses removed by prune_dominated */
+    long dominated;
+
+} beatroot_stats;
+
+/* The memory used for beat tracking, which is reused from one call of
+ * beatroot_track() to the next.  A workspace may be used by only one
+ * thread at a time. */
+typedef struct beatroot_workspace beatroot_workspace;
+
+/* Sets all the fields of params to their default values. */
+void beatroot_params_init(beatroot_params *params);
+
+/* Returns a new workspace, or NULL if there is not enough memory. */
+beatroot_workspace *beatroot_workspace_create(void);
+
+void beatroot_workspace_destroy(beatroot_workspace *workspace);
+
+/* Tracks the beats in mono audio.  The audio is read in place, and
+ * is not copied.
+ *
+ *   workspace    a workspace from beatroot_workspace_create()
+ *   pcm          the audio samples, nominally in the range -1 to 1
+ *   frames       the number of samples
+ *   sample_rate  the sample rate of the audio in Hz
+ *   params       the tracking parameters, or NULL for the defaults
+ *   beats        array in which the beat times are returned, in
+ *                seconds from the first sample
+ *   capacity     the number of elements of beats
+ *
+ * Returns the number of beats found, of which at most capacity are
+ * written, or a negative error code. */
+ptrdiff_t beatroot_track(beatroot_workspace *workspace,
+                         const float *pcm, size_t frames,
+                         float sample_rate,
+                         const beatroot_params *params,
+                         double *beats, size_t capacity);
+
+/* Estimates the tempo of mono audio by tempo induction alone,
+ * without tracking beats, which takes a small fraction of the time of
+ * beatroot_track().  The arguments are as for beatroot_track(), and:
+ *
+ *   max_seconds  the length of audio from the start from which the
+ *                tempo is estimated, or 0 to use all of it
+ *   tempi        array in which the tempo hypotheses are returned, in
+ *                beats per minute, best first
+ *   scores       array in which the score of each hypothesis is
+ *                returned (see Induction.h), or NULL
+ *   capacity     the number of elements of tempi, and of scores
+ *
+ * Returns the number of hypotheses found, of which at most capacity
+ * are written, or a negative error code.  The causal field of params
+ * is ignored. */
+ptrdiff_t beatroot_estimate_tempo(beatroot_workspace *workspace,
+                                  const float *pcm, size_t frames,
+                                  float sample_rate,
+                                  const beatroot_params *params,
+                                  double max_seconds,
+                                  double *tempi, int *scores,
+                                  size_t capacity);
+
+/* Returns non-zero if the latest call with the workspace stopped beat
+ * tracking early, at its time limit or on
+ * cancellation, so that the beats it returned cover only the start of
+ * the audio. */
+int beatroot_is_partial(const beatroot_workspace *workspace);
+
+/* Returns a new cancellation token, or NULL if there is not enough
+ * memory.  A token may be used for any number of calls, but once
+ * cancelled, it remains so. */
+beatroot_cancel_token *beatroot_cancel_token_create(void);
+
+void beatroot_cancel_token_destroy(beatroot_cancel_token *token);
+
+/* Cancels the calls of beatroot_track() given the token.  Unlike the
+ * other functions, this may be called from any thread at any time
+ * while the token exists. */
+void beatroot_cancel(beatroot_cancel_token *token);
+
+/* Gets the counters of the work done by the latest call with the
+ * workspace.  The size field of stats must be set; only the fields it
+ * covers are written.  Returns zero, or a negative error code. */
+int beatroot_get_stats(const beatroot_workspace *workspace,
+                       beatroot_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif